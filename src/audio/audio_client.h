@@ -10,7 +10,8 @@ namespace audio {
 static const std::vector<double> kStandardSamplerates{
     44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0};
 
-static const double kSampleRate = 44100.0;
+static const double kDefaultSampleRate = 44100.0;
+static const uint kDefaultBufferSize = 256;
 
 struct Device {
     int index = -1;
@@ -18,10 +19,15 @@ struct Device {
     uint inputChannels = 0;
     uint outputChannels = 0;
     std::vector<double> sampleRates = {};
+    double defaultSampleRate = kDefaultSampleRate;
 };
 
-using callback_t =
-    std::function<void(const std::vector<float>&, std::vector<float>&)>;
+/*
+Called with one non-interleaved buffer per channel and at most
+getBufferSize() frames per call.
+*/
+using callback_t = std::function<void(const float* const* inputs,
+                                      float* const* outputs, uint nFrames)>;
 
 class AudioClient {
   public:
@@ -33,13 +39,19 @@ class AudioClient {
     virtual void setCallback(callback_t callback) = 0;
     virtual void setInputDevice(Device device) { inputDevice_ = device; }
     virtual void setOutputDevice(Device device) { outputDevice_ = device; }
-    virtual double getSampleRate() const { return kSampleRate; }
+    // Stream settings take effect on the next startStream()
+    virtual void setSampleRate(double sampleRate) { sampleRate_ = sampleRate; }
+    virtual double getSampleRate() const { return sampleRate_; }
+    virtual void setBufferSize(uint nFrames) { bufferSize_ = nFrames; }
+    virtual uint getBufferSize() const { return bufferSize_; }
     virtual Device getInputDevice() const { return inputDevice_; }
     virtual Device getOutputDevice() const { return outputDevice_; }
 
   private:
     Device inputDevice_;
     Device outputDevice_;
+    double sampleRate_ = kDefaultSampleRate;
+    uint bufferSize_ = kDefaultBufferSize;
 };
 
 } // namespace audio
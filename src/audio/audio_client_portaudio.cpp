@@ -1,4 +1,5 @@
 #include "audio_client_portaudio.h"
+#include <algorithm>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
 
@@ -18,25 +19,11 @@ static int portAudioCallback(const void* inputBuffer, void* outputBuffer,
                              const PaStreamCallbackTimeInfo* timeInfo,
                              PaStreamCallbackFlags statusFlags,
                              void* userData) {
-    static std::vector<float> inputVector, outputVector;
     (void)timeInfo;
     const float* in = (const float*)inputBuffer;
     float* out = (float*)outputBuffer;
     PortAudioClient* client = reinterpret_cast<PortAudioClient*>(userData);
-    uint nInputs = client->getInputDevice().inputChannels;
-    uint nOutputs = client->getOutputDevice().outputChannels;
-    inputVector.resize(nInputs);
-    outputVector.resize(nOutputs);
-    uint inIndex = 0, outIndex = 0, i = 0, j = 0, k = 0;
-    for (i = 0; i < framesPerBuffer; ++i) {
-        for (j = 0; j < nInputs; ++j) {
-            inputVector[j] = in[inIndex++];
-        }
-        client->callCallback(inputVector, outputVector);
-        for (k = 0; k < nOutputs; ++k) {
-            out[outIndex++] = outputVector[k];
-        }
-    }
+    client->processInterleaved(in, out, framesPerBuffer);
     if (bool(statusFlags & paOutputUnderflow)) {
         spdlog::error("Output underflow detected. (xrun)");
     }
@@ -56,6 +43,7 @@ Device getDeviceAt(int index) {
     device.outputChannels =
         std::min(uint(deviceInfo->maxOutputChannels), kMaxChannels);
     device.sampleRates = {};
+    device.defaultSampleRate = deviceInfo->defaultSampleRate;
     return device;
 }
 
@@ -145,15 +133,31 @@ std::vector<Device> PortAudioClient::getAvailableOutputDevices() {
     return getAvailableDevices(/*is_input=*/false);
 }
 
-void PortAudioClient::callCallback(const std::vector<float>& input,
-                                   std::vector<float>& output) {
+void PortAudioClient::processInterleaved(const float* input, float* output,
+                                         unsigned long nFrames) {
     if (callback_ == nullptr) {
         spdlog::warn("PortAudio callback is an empty function "
                      "(PortAudioClient::callback_ = nullptr)");
         return;
     }
-
-    callback_(input, output);
+    const uint bufferSize = getBufferSize();
+    for (unsigned long done = 0; done < nFrames;) {
+        uint length = uint(std::min<unsigned long>(nFrames - done, bufferSize));
+        for (uint channel = 0; channel < nInputChannels_; ++channel) {
+            for (uint i = 0; i < length; ++i) {
+                inputBuffers_[channel][i] =
+                    input[(done + i) * nInputChannels_ + channel];
+            }
+        }
+        callback_(inputPointers_.data(), outputPointers_.data(), length);
+        for (uint channel = 0; channel < nOutputChannels_; ++channel) {
+            for (uint i = 0; i < length; ++i) {
+                output[(done + i) * nOutputChannels_ + channel] =
+                    outputBuffers_[channel][i];
+            }
+        }
+        done += length;
+    }
 }
 
 void PortAudioClient::startStream() {
@@ -167,13 +171,14 @@ void PortAudioClient::startStream() {
     }
     auto* inputParams = getDeviceStreamParameters(getInputDevice(), true);
     auto* outputParams = getDeviceStreamParameters(getOutputDevice(), false);
-    spdlog::info("Starting stream: Sample rate: {} Hz, Input: {}. {}, "
-                 "Output: {}. {}",
-                 getSampleRate(), getInputDevice().index, getInputDevice().name,
-                 getOutputDevice().index, getOutputDevice().name);
+    spdlog::info("Starting stream: Sample rate: {} Hz, Buffer: {} frames, "
+                 "Input: {}. {}, Output: {}. {}",
+                 getSampleRate(), getBufferSize(), getInputDevice().index,
+                 getInputDevice().name, getOutputDevice().index,
+                 getOutputDevice().name);
     PaError e = Pa_OpenStream(&stream_, inputParams, outputParams,
-                              getSampleRate(), paFramesPerBufferUnspecified,
-                              paNoFlag, portAudioCallback, this);
+                              getSampleRate(), getBufferSize(), paNoFlag,
+                              portAudioCallback, this);
     if (inputParams != nullptr) {
         nInputChannels_ = inputParams->channelCount;
         delete inputParams;
@@ -187,6 +192,19 @@ void PortAudioClient::startStream() {
         nOutputChannels_ = 0;
     }
     checkError(e);
+    // Channel buffers are allocated here, never in the audio callback
+    inputBuffers_.assign(nInputChannels_,
+                         std::vector<float>(getBufferSize(), 0.0f));
+    outputBuffers_.assign(nOutputChannels_,
+                          std::vector<float>(getBufferSize(), 0.0f));
+    inputPointers_.clear();
+    for (const auto& buffer : inputBuffers_) {
+        inputPointers_.emplace_back(buffer.data());
+    }
+    outputPointers_.clear();
+    for (auto& buffer : outputBuffers_) {
+        outputPointers_.emplace_back(buffer.data());
+    }
     e = Pa_StartStream(stream_);
     checkError(e);
     isStreamRunning_ = true;
@@ -19,8 +19,12 @@ class PortAudioClient : public AudioClient {
     void setCallback(callback_t callback) override;
     uint nInputChannels() { return nInputChannels_; }
     uint nOutputChannels() { return nOutputChannels_; }
-    void callCallback(const std::vector<float>& input,
-                      std::vector<float>& output);
+    /*
+    Deinterleaves one PortAudio buffer into the channel buffers allocated by
+    startStream() and runs the callback on chunks of at most getBufferSize().
+    */
+    void processInterleaved(const float* input, float* output,
+                            unsigned long nFrames);
 
   private:
     callback_t callback_;
@@ -28,6 +32,10 @@ class PortAudioClient : public AudioClient {
     bool isStreamRunning_ = false;
     uint nInputChannels_ = 0;
     uint nOutputChannels_ = 0;
+    std::vector<std::vector<float>> inputBuffers_;
+    std::vector<std::vector<float>> outputBuffers_;
+    std::vector<const float*> inputPointers_;
+    std::vector<float*> outputPointers_;
 };
 
 } // namespace audio
@@ -1,4 +1,5 @@
 #include "adder.h"
+#include <algorithm>
 #include <numeric>
 
 namespace blocks {
@@ -9,4 +10,26 @@ void Adder::evaluate() {
     outputs_[0] = std::accumulate(inputs_.cbegin(), inputs_.cend(), 0.0f);
 }
 
+void Adder::evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                           uint nFrames) {
+    float* output = outputs[0];
+    if (inputs_.empty()) {
+        std::fill_n(output, nFrames, 0.0f);
+        return;
+    }
+    if (output != inputs[0]) {
+        std::copy_n(inputs[0], nFrames, output);
+    }
+    for (uint i = 1; i < inputs_.size(); ++i) {
+        const float* input = inputs[i];
+        for (uint frame = 0; frame < nFrames; ++frame) {
+            output[frame] += input[frame];
+        }
+    }
+}
+
+std::shared_ptr<Block> Adder::clone() const {
+    return std::make_shared<Adder>(*this);
+}
+
 } // namespace blocks
@@ -9,6 +9,10 @@ class Adder : public BlockAtomic {
   public:
     Adder(uint nInputs);
     void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    std::shared_ptr<Block> clone() const override;
 };
 
 } // namespace blocks
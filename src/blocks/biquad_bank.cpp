@@ -0,0 +1,97 @@
+#include "biquad_bank.h"
+#include <algorithm>
+
+namespace blocks {
+
+namespace {
+
+// Frames transposed per pass
+constexpr uint kSpan = 64;
+
+} // namespace
+
+BiquadBank::BiquadBank(uint nChannels, std::vector<FilterBand> bands)
+    : BlockAtomic(nChannels, nChannels), nChannels_(nChannels),
+      bands_(std::move(bands)), lanes_(bands_.size() * nChannels),
+      frames_(size_t(kSpan) * nChannels) {
+    prepare(ProcessSpec{});
+}
+
+void BiquadBank::processFrame(float* frame) {
+    lanes_.advance();
+    for (size_t k = 0; k < bands_.size(); ++k) {
+        lanes_.process(frame, frame, k * nChannels_, nChannels_);
+    }
+}
+
+void BiquadBank::evaluate() {
+    std::copy(inputs_.cbegin(), inputs_.cend(), frames_.begin());
+    processFrame(frames_.data());
+    std::copy_n(frames_.cbegin(), nChannels_, outputs_.begin());
+}
+
+void BiquadBank::evaluateBuffer(InputBuffers_t inputs,
+                                OutputBuffers_t outputs, uint nFrames) {
+    for (uint done = 0; done < nFrames; done += kSpan) {
+        uint n = std::min(kSpan, nFrames - done);
+        // Every input is read before any output is written
+        for (uint channel = 0; channel < nChannels_; ++channel) {
+            for (uint frame = 0; frame < n; ++frame) {
+                frames_[frame * nChannels_ + channel] =
+                    inputs[channel][done + frame];
+            }
+        }
+        for (uint frame = 0; frame < n; ++frame) {
+            processFrame(&frames_[frame * nChannels_]);
+        }
+        for (uint channel = 0; channel < nChannels_; ++channel) {
+            for (uint frame = 0; frame < n; ++frame) {
+                outputs[channel][done + frame] =
+                    frames_[frame * nChannels_ + channel];
+            }
+        }
+    }
+}
+
+void BiquadBank::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    for (size_t k = 0; k < bands_.size(); ++k) {
+        auto coefficients = BiquadCoefficients::design(bands_[k], sampleRate_);
+        for (uint channel = 0; channel < nChannels_; ++channel) {
+            lanes_.setTarget(k * nChannels_ + channel, coefficients);
+        }
+    }
+    lanes_.snap();
+    lanes_.reset();
+}
+
+void BiquadBank::reset() { lanes_.reset(); }
+
+void BiquadBank::setParameter(uint index, float value) {
+    if (!setBandParameter(bands_, index, value)) {
+        Block::setParameter(index, value);
+    }
+    size_t k = index / 3;
+    auto coefficients = BiquadCoefficients::design(bands_[k], sampleRate_);
+    for (uint channel = 0; channel < nChannels_; ++channel) {
+        lanes_.setTarget(k * nChannels_ + channel, coefficients);
+    }
+}
+
+uint BiquadBank::getTailLength() const {
+    size_t tail = 0;
+    for (size_t k = 0; k < bands_.size(); ++k) {
+        size_t decay = lanes_.getTarget(k * nChannels_).getDecayLength();
+        if (decay >= kInfiniteTail) {
+            return kInfiniteTail;
+        }
+        tail += decay;
+    }
+    return uint(std::min<size_t>(tail, kInfiniteTail));
+}
+
+std::shared_ptr<Block> BiquadBank::clone() const {
+    return std::make_shared<BiquadBank>(*this);
+}
+
+} // namespace blocks
@@ -0,0 +1,44 @@
+#ifndef BLOCKS_BIQUAD_BANK_H
+#define BLOCKS_BIQUAD_BANK_H
+
+#include "block.h"
+#include "processes/biquad.h"
+
+namespace blocks {
+
+/*
+The same cascade of biquads on each of nChannels channels: input i is
+filtered to output i. Parameters are those of Biquad and apply to every
+channel.
+
+The sections of all channels are lanes of one BiquadLanes, grouped section by
+section, and buffers are transposed to interleaved frames in chunks, so each
+section runs across all channels in one vectorized loop per frame. Prefer one
+bank over one Biquad per channel when several signals share an equalizer.
+*/
+class BiquadBank : public BlockAtomic {
+  public:
+    BiquadBank(uint nChannels, std::vector<FilterBand> bands);
+    void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    void setParameter(uint index, float value) override;
+    uint getTailLength() const override;
+    std::shared_ptr<Block> clone() const override;
+
+  private:
+    void processFrame(float* frame);
+    uint nChannels_;
+    std::vector<FilterBand> bands_;
+    double sampleRate_ = kDefaultSampleRate;
+    BiquadLanes lanes_;
+    // A chunk of frames, channels interleaved
+    std::vector<float> frames_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_BIQUAD_BANK_H
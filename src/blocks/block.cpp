@@ -8,6 +8,12 @@ namespace blocks {
 Block::Block(uint nInputs, uint nOutputs)
     : inputs_(nInputs, 0), outputs_(nOutputs, 0) {}
 
+void Block::prepare(const ProcessSpec& /*spec*/) {}
+
+std::function<void()> Block::prepareParameter(uint index, float value) {
+    return [this, index, value] { setParameter(index, value); };
+}
+
 void Block::setInput(float value, uint portIdx) {
     if (portIdx >= inputs_.size()) {
         throw illegal_port_error(
@@ -28,6 +34,49 @@ float Block::getOutput(uint portIdx) const {
     return outputs_[portIdx];
 }
 
+void Block::evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                           uint nFrames) {
+    for (uint frame = 0; frame < nFrames; ++frame) {
+        for (uint i = 0; i < inputs_.size(); ++i) {
+            inputs_[i] = inputs[i][frame];
+        }
+        evaluate();
+        for (uint i = 0; i < outputs_.size(); ++i) {
+            outputs[i][frame] = outputs_[i];
+        }
+    }
+}
+
+void Block::setParameter(uint index, float /*value*/) {
+    throw invalid_operation_error(
+        fmt::format("Block '{}' has no parameter {}", name_, index));
+}
+
+void Block::setRateDivisor(uint divisor) {
+    if (divisor == 0) {
+        throw invalid_operation_error("Rate divisor must be at least 1");
+    }
+    rateDivisor_ = divisor;
+}
+
+uint Block::getQualityLevelCount() const {
+    return 1 + getFallbackCount() + (bypassUnderLoad_ ? 1 : 0);
+}
+
+void Block::setQualityLevel(uint level) {
+    qualityLevel_ = std::min(level, getQualityLevelCount() - 1);
+    onQualityLevel(std::min(qualityLevel_, getFallbackCount()));
+}
+
+void Block::setBypassUnderLoad(bool allowed) {
+    bypassUnderLoad_ = allowed;
+    setQualityLevel(qualityLevel_);
+}
+
+bool Block::isSuspended() const {
+    return bypassUnderLoad_ && qualityLevel_ == getFallbackCount() + 1;
+}
+
 uint Block::getInputSize() const { return inputs_.size(); }
 uint Block::getOutputSize() const { return outputs_.size(); }
 
@@ -48,6 +97,42 @@ void BlockComposite::addBlock(std::shared_ptr<Block> block) {
     blocks_.emplace_back(block);
 }
 
+void BlockComposite::prepare(const ProcessSpec& spec) {
+    for (const auto& block : blocks_) {
+        block->prepare(spec);
+    }
+}
+
+void BlockComposite::reset() {
+    for (const auto& block : blocks_) {
+        block->reset();
+    }
+}
+
+size_t BlockComposite::getRealtimeMemory(const ProcessSpec& spec) const {
+    size_t bytes = 0;
+    for (const auto& block : blocks_) {
+        bytes += block->getRealtimeMemory(spec);
+    }
+    return bytes;
+}
+
+size_t BlockComposite::getMemoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& block : blocks_) {
+        bytes += block->getMemoryUsage();
+    }
+    return bytes;
+}
+
+float BlockComposite::getCostEstimate() const {
+    float cost = 0.0f;
+    for (const auto& block : blocks_) {
+        cost += block->getCostEstimate() / float(block->getRateDivisor());
+    }
+    return cost;
+}
+
 void BlockComposite::removeBlock(std::shared_ptr<Block> block) {
     auto it = std::find(blocks_.cbegin(), blocks_.cend(), block);
     if (it == blocks_.cend()) {
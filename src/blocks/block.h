@@ -1,6 +1,9 @@
 #ifndef BLOCKS_BLOCK_H
 #define BLOCKS_BLOCK_H
 
+#include "processes/process_spec.h"
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,11 +11,119 @@
 namespace blocks {
 
 using PortValues_t = std::vector<float>;
+using InputBuffers_t = const float* const*;
+using OutputBuffers_t = float* const*;
+
+constexpr uint kInfiniteTail = std::numeric_limits<uint>::max();
 
 class Block {
   public:
     Block(uint nInputs, uint nOutputs);
+    virtual ~Block() = default;
     virtual void evaluate() = 0;
+    /*
+    Allocates whatever processing at the given sample rate and buffer size
+    needs. Called before the stream starts, never while processing.
+    */
+    virtual void prepare(const ProcessSpec& spec);
+    /*
+    Upper bound, in bytes, of the pool the block holds at any one time once
+    prepared with the given spec, state drawn in prepare() included. Each
+    allocation counts as RealtimeAllocator::getChunkSize() of its request,
+    header included. Its system reserves the sum in spec.allocator before
+    prepare().
+    */
+    virtual size_t getRealtimeMemory(const ProcessSpec& /*spec*/) const {
+        return 0;
+    }
+    /*
+    Bytes of processing state the block holds, such as delay lines; a
+    composite reports the sum over its blocks.
+    */
+    virtual size_t getMemoryUsage() const { return 0; }
+    /*
+    Returns to the state right after prepare(): clears delay lines, filter
+    memories and the like. Must not allocate.
+    */
+    virtual void reset() {}
+    /*
+    Processes nFrames samples at once, one buffer per port. The default
+    implementation steps evaluate() sample by sample.
+    */
+    virtual void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                                uint nFrames);
+    /*
+    True if output 0 may share its buffer with input 0.
+    */
+    virtual bool canProcessInPlace() const { return false; }
+    /*
+    Creates an independent copy of the block, including its processing state.
+    */
+    virtual std::shared_ptr<Block> clone() const = 0;
+    /*
+    Relative processing cost, used to balance work between threads.
+    */
+    virtual float getCostEstimate() const { return 1.0f; }
+    /*
+    Changes a block-specific parameter, e.g. the gain of a Gain process.
+    Throws invalid_operation_error for unknown indices.
+    */
+    virtual void setParameter(uint index, float value);
+    /*
+    Parameter change in two parts, see BlockSystem::setParameterAsync(): the
+    heavy part runs here, on a job-system worker, and the returned commit
+    switches the result in on the processing thread without allocating. The
+    default defers the whole change to setParameter().
+    */
+    virtual std::function<void()> prepareParameter(uint index, float value);
+    /*
+    A block with a rate divisor N > 1 runs at control rate: once every N
+    samples, reading its inputs at that sample. Its outputs ramp linearly to
+    each new value where they feed audio-rate blocks and are held otherwise.
+    Blocks already inside a system are retuned through
+    BlockSystem::setRateDivisor().
+    */
+    void setRateDivisor(uint divisor);
+    uint getRateDivisor() const { return rateDivisor_; }
+    /*
+    Number of frames the outputs may stay non-zero after the inputs fall
+    silent. Blocks whose inputs have been silent for longer are skipped.
+    Stateless blocks keep the default of 0; kInfiniteTail never skips.
+    */
+    virtual uint getTailLength() const { return 0; }
+    /*
+    Frames the outputs lag the inputs by, e.g. the lookahead of a limiter,
+    so that signals bypassing the block can be aligned with it. Fractional
+    for blocks that run at another rate inside.
+    */
+    virtual float getLatency() const { return 0.0f; }
+    /*
+    A bypassed block is left out of its system's plan: each output port
+    passes on what feeds the input port with the same index. Like the rate
+    divisor, blocks already inside a system are changed through the system.
+    */
+    void setBypassed(bool bypassed) { bypassed_ = bypassed; }
+    bool isBypassed() const { return bypassed_; }
+    /*
+    A guarded block whose outputs contain NaN or Inf is muted for that run
+    and reset, so the values never reach other blocks. On by default; can be
+    switched at any time.
+    */
+    void setNonFiniteGuard(bool enabled) { nonFiniteGuard_ = enabled; }
+    bool hasNonFiniteGuard() const { return nonFiniteGuard_; }
+    /*
+    Quality levels for CPU overload: level 0 is full quality and every
+    higher level is cheaper. A block implements getFallbackCount() cheaper
+    modes through onQualityLevel(); a block that may be switched off under
+    load gets one more level, at which the executor passes input 0 through
+    instead of running it. Levels are changed on the processing thread.
+    */
+    uint getQualityLevelCount() const;
+    void setQualityLevel(uint level);
+    uint getQualityLevel() const { return qualityLevel_; }
+    void setBypassUnderLoad(bool allowed);
+    bool isBypassableUnderLoad() const { return bypassUnderLoad_; }
+    bool isSuspended() const;
     void setInput(float value, uint portIdx = 0);
     float getOutput(uint portIdx = 0) const;
     uint getInputSize() const;
@@ -21,25 +132,43 @@ class Block {
     std::string_view getName() const;
 
   protected:
+    virtual uint getFallbackCount() const { return 0; }
+    // Switches to fallback mode `level` (0 - full quality); must not allocate
+    virtual void onQualityLevel(uint /*level*/) {}
     PortValues_t inputs_;
     PortValues_t outputs_;
 
   private:
     std::string name_ = "";
+    uint rateDivisor_ = 1;
+    bool bypassed_ = false;
+    bool nonFiniteGuard_ = true;
+    bool bypassUnderLoad_ = false;
+    uint qualityLevel_ = 0;
 };
 
 class BlockAtomic : public Block {
   public:
     BlockAtomic(uint nInputs, uint nOutputs);
     virtual void evaluate() override = 0;
+    virtual std::shared_ptr<Block> clone() const override = 0;
 };
 
 class BlockComposite : public Block {
   public:
     BlockComposite(uint nInputs, uint nOutputs);
     virtual void evaluate() override = 0;
+    virtual std::shared_ptr<Block> clone() const override = 0;
     virtual void addBlock(std::shared_ptr<Block> block);
     virtual void removeBlock(std::shared_ptr<Block> block);
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    const std::vector<std::shared_ptr<Block>>& viewBlocks() const {
+        return blocks_;
+    }
+    float getCostEstimate() const override;
 
   protected:
     std::vector<std::shared_ptr<Block>> blocks_;
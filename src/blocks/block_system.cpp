@@ -1,47 +1,167 @@
 #include "block_system.h"
+#include "denormals.h"
 #include "evaluation_sequence.h"
 #include "exceptions.h"
+#include "execution_plan.h"
+#include "job_system.h"
+#include "realtime_allocator.h"
 #include <algorithm>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
 
 namespace blocks {
 
-BlockSystem::BlockSystem() : BlockComposite(0, 0) {}
+namespace {
+
+int findStep(const StepCounters& counters, const Block* block) {
+    auto it = std::find(counters.blocks.cbegin(), counters.blocks.cend(),
+                        block);
+    return it == counters.blocks.cend() ? -1
+                                        : int(it - counters.blocks.cbegin());
+}
+
+} // namespace
+
+BlockSystem::BlockSystem()
+    : BlockComposite(0, 0), plan_(std::make_shared<const ExecutionPlan>()),
+      planState_(std::make_unique<PlanState>()) {
+    preparePlanState(*plan_, blocks_, *planState_, spec_.maxBlockSize);
+    publishCounters();
+}
+
+BlockSystem::~BlockSystem() = default;
+
+std::shared_ptr<Block> BlockSystem::clone() const {
+    auto system = std::make_shared<BlockSystem>();
+    system->setName(std::string(getName()));
+    system->setRateDivisor(getRateDivisor());
+    system->setBypassed(isBypassed());
+    system->setNonFiniteGuard(hasNonFiniteGuard());
+    system->setBypassUnderLoad(isBypassableUnderLoad());
+    system->setQualityLevel(getQualityLevel());
+    std::map<std::shared_ptr<Block>, std::shared_ptr<Block>> copies;
+    for (const auto& block : blocks_) {
+        auto copy = block->clone();
+        copies.emplace(block, copy);
+        system->blocks_.emplace_back(copy);
+    }
+    auto remap = [&copies](Port port) {
+        port.block = copies.at(port.block);
+        return port;
+    };
+    for (const auto& [block, blockConnections] : connections_) {
+        auto& copyConnections = system->connections_[copies.at(block)];
+        copyConnections.reserve(blockConnections.size());
+        for (auto connection : blockConnections) {
+            connection.source = remap(connection.source);
+            connection.target = remap(connection.target);
+            copyConnections.emplace_back(connection);
+        }
+    }
+    for (const auto& port : inputConnections_) {
+        system->inputConnections_.emplace_back(remap(port));
+    }
+    for (const auto& port : outputConnections_) {
+        system->outputConnections_.emplace_back(remap(port));
+    }
+    system->inputs_ = inputs_;
+    system->outputs_ = outputs_;
+    system->evalSequence_ = evalSequence_;
+    system->spec_ = spec_;
+    // Clones may run on other threads, so they never share a pool; their
+    // lines live on the heap until prepare() draws them from one of their own
+    system->spec_.allocator = nullptr;
+    system->plan_ = plan_;
+    system->shouldUpdateEvalSequence_ = shouldUpdateEvalSequence_;
+    *system->planState_ = *planState_;
+    // The clone counts on its own, from a snapshot naming its own blocks
+    auto counters = std::make_shared<StepCounters>(*planState_->counters);
+    for (auto& counted : counters->blocks) {
+        auto it = std::find_if(
+            blocks_.cbegin(), blocks_.cend(),
+            [counted](const auto& block) { return block.get() == counted; });
+        counted = it == blocks_.cend()
+                      ? nullptr
+                      : system->blocks_[it - blocks_.cbegin()].get();
+    }
+    system->planState_->counters = std::move(counters);
+    system->publishCounters();
+    return system;
+}
 
 void BlockSystem::evaluate() {
-    if (shouldUpdateEvalSequence_) {
-        updateEvaluationSequence();
-        shouldUpdateEvalSequence_ = false;
-    }
-    // spdlog::info("Evaluating blocks");
-    // spdlog::info("Sequence: {}", fmt::join(evalSequence_, ", "));
-    // Set inputs
-    for (uint i = 0; i < inputConnections_.size(); ++i) {
-        auto port = inputConnections_[i];
-        port.block->setInput(inputs_[i], port.port);
-    }
-    // Evaluate blocks
-    for (auto blockIdx : evalSequence_) {
-        auto block = blocks_[blockIdx];
-        // spdlog::info("Evaluating: {}", block->getName());
-        block->evaluate();
-        for (const auto& connection : connections_[block]) {
-            float value =
-                connection.source.block->getOutput(connection.source.port);
-            connection.target.block->setInput(value, connection.target.port);
+    inputPointers_.resize(inputs_.size());
+    outputPointers_.resize(outputs_.size());
+    for (uint i = 0; i < inputs_.size(); ++i) {
+        inputPointers_[i] = &inputs_[i];
+    }
+    for (uint i = 0; i < outputs_.size(); ++i) {
+        outputPointers_[i] = &outputs_[i];
+    }
+    evaluateBuffer(inputPointers_.data(), outputPointers_.data(), 1);
+}
+
+void BlockSystem::evaluateBuffer(InputBuffers_t inputs,
+                                 OutputBuffers_t outputs, uint nFrames) {
+    ScopedFlushDenormals flushDenormals;
+    if (jobs_ != nullptr) {
+        jobs_->dispatch();
+    }
+    updatePlanIfNeeded();
+    planState_->events.clear();
+    executePlan(*plan_, blocks_, *planState_, inputs, outputs, nFrames);
+}
+
+void BlockSystem::evaluateBuffer(InputBuffers_t inputs,
+                                 OutputBuffers_t outputs, uint nFrames,
+                                 const Events_t& events) {
+    ScopedFlushDenormals flushDenormals;
+    if (jobs_ != nullptr) {
+        jobs_->dispatch();
+    }
+    updatePlanIfNeeded();
+    auto& planEvents = planState_->events;
+    planEvents.clear();
+    for (const auto& event : events) {
+        auto it = std::find(blocks_.cbegin(), blocks_.cend(), event.block);
+        if (it == blocks_.cend()) {
+            throw invalid_operation_error(
+                "Event targets a block not present in the block system");
+        }
+        if (event.offset >= nFrames ||
+            (!planEvents.empty() && event.offset < planEvents.back().offset)) {
+            throw invalid_operation_error(fmt::format(
+                "Event offsets must be sorted and below {}", nFrames));
         }
+        planEvents.emplace_back(PlanEvent{event.offset,
+                                          uint(it - blocks_.cbegin()),
+                                          event.parameter, event.value});
     }
-    // Set outputs
-    for (uint i = 0; i < outputConnections_.size(); ++i) {
-        auto port = outputConnections_[i];
-        outputs_[i] = port.block->getOutput(port.port);
+    executePlan(*plan_, blocks_, *planState_, inputs, outputs, nFrames);
+}
+
+void BlockSystem::prepare(const ProcessSpec& spec) {
+    spec_ = spec;
+    if (spec.allocator == nullptr) {
+        pool_ = std::make_shared<RealtimeAllocator>(getRealtimeMemory(spec));
+        spec_.allocator = pool_;
+    } else {
+        pool_.reset();
     }
+    BlockComposite::prepare(spec_);
+    updateEvaluationSequence();
+}
+
+void BlockSystem::reset() {
+    BlockComposite::reset();
+    resetPlanState(*planState_);
 }
 
 void BlockSystem::addBlock(std::shared_ptr<Block> block) {
     BlockComposite::addBlock(block);
+    block->prepare(spec_);
     connections_.emplace(block, std::vector<Connection>());
+    shouldUpdateEvalSequence_ = true;
 }
 
 void BlockSystem::removeBlock(std::shared_ptr<Block> block) {
@@ -50,6 +170,7 @@ void BlockSystem::removeBlock(std::shared_ptr<Block> block) {
     connections_.erase(it);
     breakConnectionsTo(block);
     breakInputsOutputsTo(block);
+    shouldUpdateEvalSequence_ = true;
 }
 
 void BlockSystem::addConnection(Connection connection) {
@@ -58,9 +179,9 @@ void BlockSystem::addConnection(Connection connection) {
         throw invalid_operation_error(
             "Cannot connect: blocks from outside block system");
     }
-    if (isPortConnected(connection.source, PortType::OUTPUT) ||
-        isPortConnected(connection.target, PortType::INPUT)) {
-        throw invalid_operation_error("Cannot connect: port already connected");
+    if (hasConnection(connection)) {
+        throw invalid_operation_error(
+            "Cannot connect: ports already connected");
     }
     if (connection.source.port >= connection.source.block->getOutputSize() ||
         connection.target.port >= connection.target.block->getInputSize()) {
@@ -85,12 +206,13 @@ void BlockSystem::removeConnection(Connection connection) {
 }
 
 void BlockSystem::addInput(Port port) {
-    if (isPortConnected(port, PortType::INPUT) ||
+    if (isSystemPort(port, PortType::INPUT) ||
         port.block->getInputSize() <= port.port) {
         throw invalid_operation_error("Cannot add input: invalid port");
     }
     inputs_.emplace_back(0.0f);
     inputConnections_.emplace_back(port);
+    shouldUpdateEvalSequence_ = true;
 }
 
 void BlockSystem::removeInput(Port port) {
@@ -103,15 +225,17 @@ void BlockSystem::removeInput(Port port) {
     uint portIdx = it - inputConnections_.cbegin();
     inputConnections_.erase(inputConnections_.begin() + portIdx);
     inputs_.erase(inputs_.begin() + portIdx);
+    shouldUpdateEvalSequence_ = true;
 }
 
 void BlockSystem::addOutput(Port port) {
-    if (isPortConnected(port, PortType::OUTPUT) ||
+    if (isSystemPort(port, PortType::OUTPUT) ||
         port.block->getOutputSize() <= port.port) {
         throw invalid_operation_error("Cannot add output: invalid port");
     }
     outputs_.emplace_back(0.0f);
     outputConnections_.emplace_back(port);
+    shouldUpdateEvalSequence_ = true;
 }
 
 void BlockSystem::removeOutput(Port port) {
@@ -124,10 +248,116 @@ void BlockSystem::removeOutput(Port port) {
     uint portIdx = it - outputConnections_.cbegin();
     outputConnections_.erase(outputConnections_.begin() + portIdx);
     outputs_.erase(outputs_.begin() + portIdx);
+    shouldUpdateEvalSequence_ = true;
+}
+
+void BlockSystem::setRateDivisor(std::shared_ptr<Block> block,
+                                 uint divisor) {
+    if (!hasBlock(block)) {
+        throw invalid_operation_error(
+            "Cannot set rate divisor: block not present in the block system");
+    }
+    block->setRateDivisor(divisor);
+    requestPlanUpdate();
+}
+
+void BlockSystem::setBypassed(std::shared_ptr<Block> block, bool bypassed) {
+    if (!hasBlock(block)) {
+        throw invalid_operation_error(
+            "Cannot bypass: block not present in the block system");
+    }
+    block->setBypassed(bypassed);
+    requestPlanUpdate();
+}
+
+void BlockSystem::setJobSystem(std::shared_ptr<JobSystem> jobs) {
+    jobs_ = jobs;
+}
+
+void BlockSystem::setParameterAsync(std::shared_ptr<Block> block, uint index,
+                                    float value) {
+    if (!hasBlock(block)) {
+        throw invalid_operation_error(
+            "Cannot set parameter: block not present in the block system");
+    }
+    if (jobs_ == nullptr) {
+        throw invalid_operation_error(
+            "Cannot set parameter asynchronously: no job system attached");
+    }
+    jobs_->submit([block, index, value]() -> JobSystem::Commit_t {
+        auto commit = block->prepareParameter(index, value);
+        return [block, commit] { commit(); };
+    });
+}
+
+void BlockSystem::requestPlanUpdate() {
+    // Pending structural edits recompile on the next evaluation anyway
+    if (jobs_ == nullptr || shouldUpdateEvalSequence_) {
+        shouldUpdateEvalSequence_ = true;
+        return;
+    }
+    uint generation = ++planGeneration_;
+    uint maxFrames = spec_.maxBlockSize;
+    jobs_->submit([this, generation, maxFrames, blocks = blocks_,
+                   connections = connections_, inputs = inputConnections_,
+                   outputs = outputConnections_]() -> JobSystem::Commit_t {
+        auto sequence = std::make_shared<std::vector<uint>>(
+            computeEvaluationSequence(blocks, connections));
+        std::shared_ptr<const ExecutionPlan> plan =
+            std::make_shared<const ExecutionPlan>(compileExecutionPlan(
+                *sequence, blocks, connections, inputs, outputs));
+        auto state = std::make_shared<PlanState>();
+        preparePlanState(*plan, blocks, *state, maxFrames);
+        // Swapped-out plan and state stay in the commit's captures
+        return [this, generation, sequence, plan, state]() mutable {
+            if (generation != planGeneration_) {
+                return;
+            }
+            std::swap(evalSequence_, *sequence);
+            std::swap(plan_, plan);
+            std::swap(*planState_, *state);
+            // The old counters stay referenced by the swapped-out state
+            publishCounters();
+        };
+    });
 }
 
 void BlockSystem::updateEvaluationSequence() {
     evalSequence_ = computeEvaluationSequence(blocks_, connections_);
+    plan_ = std::make_shared<const ExecutionPlan>(
+        compileExecutionPlan(evalSequence_, blocks_, connections_,
+                             inputConnections_, outputConnections_));
+    preparePlanState(*plan_, blocks_, *planState_, spec_.maxBlockSize);
+    publishCounters();
+    shouldUpdateEvalSequence_ = false;
+    ++planGeneration_;
+}
+
+void BlockSystem::publishCounters() {
+    std::atomic_store(&counters_, std::shared_ptr<const StepCounters>(
+                                      planState_->counters));
+}
+
+uint BlockSystem::getDenormalCount(std::shared_ptr<Block> block) const {
+    auto counters = std::atomic_load(&counters_);
+    int step = findStep(*counters, block.get());
+    return step < 0 ? 0 : counters->denormals[step].get();
+}
+
+uint BlockSystem::getQuarantineCount(std::shared_ptr<Block> block) const {
+    auto counters = std::atomic_load(&counters_);
+    int step = findStep(*counters, block.get());
+    return step < 0 ? 0 : counters->quarantines[step].get();
+}
+
+uint BlockSystem::getScratchBufferCount() {
+    updatePlanIfNeeded();
+    return plan_->nBuffers;
+}
+
+std::shared_ptr<const ExecutionPlan> BlockSystem::getExecutionPlan() {
+    updatePlanIfNeeded();
+    return plan_;
 }
 
 bool BlockSystem::hasBlock(std::shared_ptr<Block> block) const {
@@ -146,17 +376,13 @@ bool BlockSystem::hasConnection(Connection connection) const {
     return false;
 }
 
-bool BlockSystem::isPortConnected(Port port, PortType type) const {
-    // Check if port is used by a block connection
-    for (const auto& [block, block_connections] : connections_) {
-        for (const auto& connection : block_connections) {
-            if ((connection.source == port && type == PortType::OUTPUT) ||
-                (connection.target == port && type == PortType::INPUT)) {
-                return true;
-            }
-        }
+void BlockSystem::updatePlanIfNeeded() {
+    if (shouldUpdateEvalSequence_) {
+        updateEvaluationSequence();
     }
-    // Check if port is used by block system input/output
+}
+
+bool BlockSystem::isSystemPort(Port port, PortType type) const {
     return ((type == PortType::INPUT &&
              std::find(inputConnections_.cbegin(), inputConnections_.cend(),
                        port) != inputConnections_.cend()) ||
@@ -175,19 +401,21 @@ void BlockSystem::breakConnectionsTo(std::shared_ptr<Block> block) {
     };
     for (auto& [source_block, block_connections] : connections_) {
         auto it = findNextConnectionTo(block, block_connections);
-        if (it != block_connections.cend()) {
+        while (it != block_connections.cend()) {
             block_connections.erase(it);
             it = findNextConnectionTo(block, block_connections);
         }
     }
 }
 void BlockSystem::breakInputsOutputsTo(std::shared_ptr<Block> block) {
-    for (const auto& port : inputConnections_) {
+    auto inputs = inputConnections_;
+    for (const auto& port : inputs) {
         if (port.block == block) {
             removeInput(port);
         }
     }
-    for (const auto& port : outputConnections_) {
+    auto outputs = outputConnections_;
+    for (const auto& port : outputs) {
         if (port.block == block) {
             removeOutput(port);
         }
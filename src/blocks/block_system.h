@@ -2,12 +2,18 @@
 #define BLOCKS_BLOCK_SYSTEM_H
 
 #include "block.h"
+#include <atomic>
 #include <map>
 #include <memory>
 #include <vector>
 
 namespace blocks {
 
+struct ExecutionPlan;
+struct PlanState;
+struct StepCounters;
+class JobSystem;
+
 struct Port {
     std::shared_ptr<Block> block;
     uint port = 0;
@@ -16,18 +22,64 @@ struct Port {
     }
 };
 
+/*
+An output port may drive any number of connections, which all read the same
+buffer. Connections into one input port are summed, each scaled by its gain.
+*/
 struct Connection {
     Port source;
     Port target;
+    float gain = 1.0f;
     bool operator==(const Connection& rhs) const {
         return (source == rhs.source && target == rhs.target);
     }
 };
 
+/*
+Parameter change landing on frame `offset` of the buffer it is passed with.
+*/
+struct Event {
+    uint offset = 0;
+    std::shared_ptr<Block> block;
+    uint parameter = 0;
+    float value = 0.0f;
+};
+
+using Events_t = std::vector<Event>;
+
+/*
+The compiled execution plan is immutable and shared between a system and its
+clones; each instance only owns its blocks' state and its scratch buffers.
+Compile the plan (updateEvaluationSequence() or evaluate()) before cloning
+to let the copies reuse it.
+*/
 class BlockSystem : public BlockComposite {
   public:
     BlockSystem();
+    ~BlockSystem() override;
     void evaluate() override;
+    /*
+    Prepares every block and sizes the scratch buffers for
+    spec.maxBlockSize frames; longer buffers are processed in chunks. Blocks
+    added later are prepared with the same spec.
+
+    Without spec.allocator the system reserves a pool for its whole graph,
+    sized by getRealtimeMemory(), and nested systems draw from it. Blocks
+    added later share that pool until the system is prepared again. Clones
+    reserve no pool until they are prepared themselves.
+    */
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    /*
+    Applies events, sorted by offset, exactly on their frames. Only the
+    blocks they target split their work at those offsets; everything else
+    still runs over the whole buffer.
+    */
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames, const Events_t& events);
+    std::shared_ptr<Block> clone() const override;
     void addBlock(std::shared_ptr<Block> block) override;
     void removeBlock(std::shared_ptr<Block> block) override;
     void addConnection(Connection connection);
@@ -36,18 +88,69 @@ class BlockSystem : public BlockComposite {
     void removeInput(Port port);
     void addOutput(Port port);
     void removeOutput(Port port);
+    using Block::setRateDivisor;
+    void setRateDivisor(std::shared_ptr<Block> block, uint divisor);
+    using Block::setBypassed;
+    void setBypassed(std::shared_ptr<Block> block, bool bypassed);
+    /*
+    Attaches workers for heavy reconfiguration. With a job system,
+    setRateDivisor() and setBypassed() recompile the plan on a worker, and
+    evaluateBuffer() first switches in whatever work has finished. Structural
+    edits (blocks, connections, ports) still recompile on the next
+    evaluation and must not overlap processing. The system must outlive the
+    work it submits.
+    */
+    void setJobSystem(std::shared_ptr<JobSystem> jobs);
+    /*
+    Runs block->prepareParameter() on the job system and applies its commit
+    at the start of a later buffer. Call from a non-real-time thread.
+    */
+    void setParameterAsync(std::shared_ptr<Block> block, uint index,
+                           float value);
+    // Inner blocks skip silence on their own
+    uint getTailLength() const override { return kInfiniteTail; }
     void updateEvaluationSequence();
     const std::vector<uint>& viewEvaluationSequence() { return evalSequence_; }
     bool hasBlock(std::shared_ptr<Block> block) const;
     bool hasConnection(Connection connection) const;
+    uint getScratchBufferCount();
+    /*
+    Number of processing runs in which the block's outputs held subnormal
+    samples (flushed before anything read them). Safe to call while another
+    thread processes: readers take a reference to the counters of the plan
+    in use, which the processing thread only replaces when it switches
+    plans. Counts restart when the plan is recompiled.
+    */
+    uint getDenormalCount(std::shared_ptr<Block> block) const;
+    // Number of times the block was muted and reset for emitting NaN/Inf;
+    // as safe to call while processing as getDenormalCount()
+    uint getQuarantineCount(std::shared_ptr<Block> block) const;
+    std::shared_ptr<const ExecutionPlan> getExecutionPlan();
+    const ProcessSpec& getProcessSpec() const { return spec_; }
 
   private:
     enum class PortType { INPUT, OUTPUT };
-    bool isPortConnected(Port port, PortType type) const;
+    bool isSystemPort(Port port, PortType type) const;
     void breakConnectionsTo(std::shared_ptr<Block> block);
     void breakInputsOutputsTo(std::shared_ptr<Block> block);
+    void updatePlanIfNeeded();
+    void requestPlanUpdate();
+    // Makes the counters of planState_ the ones readers see
+    void publishCounters();
     bool shouldUpdateEvalSequence_ = false;
+    ProcessSpec spec_;
+    // Pool of the whole graph; nested systems draw from their parent's
+    std::shared_ptr<RealtimeAllocator> pool_;
+    std::shared_ptr<JobSystem> jobs_;
+    // Lets a background compile tell whether the plan changed meanwhile
+    std::atomic<uint> planGeneration_{0};
     std::vector<uint> evalSequence_;
+    std::shared_ptr<const ExecutionPlan> plan_;
+    std::unique_ptr<PlanState> planState_;
+    // Shared with planState_, and only accessed with std::atomic_load/store
+    std::shared_ptr<const StepCounters> counters_;
+    std::vector<const float*> inputPointers_;
+    std::vector<float*> outputPointers_;
     std::map<std::shared_ptr<Block>, std::vector<Connection>> connections_;
     std::vector<Port> inputConnections_;
     std::vector<Port> outputConnections_;
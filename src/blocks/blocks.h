@@ -2,11 +2,27 @@
 #define BLOCKS_CORE_H
 
 #include "adder.h"
+#include "biquad_bank.h"
 #include "block_system.h"
+#include "denormals.h"
+#include "dynamics.h"
 #include "exceptions.h"
+#include "job_system.h"
+#include "load_governor.h"
+#include "modulated_delay.h"
+#include "multi_tap_delay.h"
+#include "oscillator.h"
+#include "oversampler.h"
+#include "pipeline.h"
 #include "process_block.h"
+#include "processes/biquad.h"
+#include "processes/convolution.h"
 #include "processes/delay.h"
+#include "processes/fdn_reverb.h"
+#include "processes/fft.h"
 #include "processes/gain.h"
+#include "processes/waveshaper.h"
+#include "realtime_allocator.h"
 #include "splitter.h"
 
 #endif // BLOCKS_CORE_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef BLOCKS_DENORMALS_H
+#define BLOCKS_DENORMALS_H
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define BLOCKS_HAS_MXCSR 1
+#endif
+
+namespace blocks {
+
+// Feedback state below this magnitude (about -400 dB) is flushed to zero
+constexpr float kFlushThreshold = 1e-20f;
+
+inline float flushToZero(float x) {
+    return std::fabs(x) < kFlushThreshold ? 0.0f : x;
+}
+
+/*
+Turns on flush-to-zero and denormals-are-zero for the calling thread while in
+scope and restores the previous mode afterwards. Does nothing on CPUs without
+such a mode.
+*/
+class ScopedFlushDenormals {
+  public:
+    ScopedFlushDenormals() {
+#if defined(BLOCKS_HAS_MXCSR)
+        previous_ = _mm_getcsr();
+        _mm_setcsr(unsigned(previous_) | kFtzDaz);
+#elif defined(__aarch64__)
+        asm volatile("mrs %0, fpcr" : "=r"(previous_));
+        asm volatile("msr fpcr, %0" : : "r"(previous_ | kFz));
+#endif
+    }
+    ~ScopedFlushDenormals() {
+#if defined(BLOCKS_HAS_MXCSR)
+        _mm_setcsr(unsigned(previous_));
+#elif defined(__aarch64__)
+        asm volatile("msr fpcr, %0" : : "r"(previous_));
+#endif
+    }
+    ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+    ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+  private:
+    static constexpr unsigned kFtzDaz = 0x8040;
+    static constexpr uint64_t kFz = uint64_t(1) << 24;
+    uint64_t previous_ = 0;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_DENORMALS_H
@@ -0,0 +1,252 @@
+#include "dynamics.h"
+#include "denormals.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace blocks {
+
+namespace {
+
+// Frames per pass of the gain computation
+constexpr size_t kSpan = 64;
+constexpr float kDbPerOctave = 6.0205999f;
+// Levels below about -200 dB count as -200 dB
+constexpr float kLevelFloor = 1e-10f;
+
+/*
+log2 and exp2 of normal floats from the exponent bits and a cubic
+correction on the mantissa; within 0.001 dB and 6e-6 relative error. Both
+are exact at powers of two and vectorize.
+*/
+inline float fastLog2(float x) {
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    float exponent = float((bits >> 23) - 127);
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    float mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(bits));
+    float u = mantissa - 1.0f;
+    return exponent + u +
+           u * (u - 1.0f) *
+               (-0.43807325f + u * (0.23669342f - u * 0.080307304f));
+}
+
+inline float fastExp2(float y) {
+    y = std::min(std::max(y, -126.0f), 126.0f);
+    // Truncating a positive number floors it
+    int whole = int(y + 127.0f) - 127;
+    float f = y - float(whole);
+    float fraction = 1.0f + f +
+                     f * (f - 1.0f) *
+                         (0.30700434f + f * (0.065438747f + f * 0.013686471f));
+    int32_t bits = (whole + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return fraction * scale;
+}
+
+size_t lookaheadFrames(float lookahead, double sampleRate) {
+    return size_t(std::lround(std::max(double(lookahead), 0.0) * sampleRate));
+}
+
+float smoothingCoefficient(float time, double sampleRate) {
+    return time > 0.0f ? float(std::exp(-1.0 / (double(time) * sampleRate)))
+                       : 0.0f;
+}
+
+} // namespace
+
+Dynamics::Dynamics(uint nChannels, DynamicsSettings settings, uint linkSize)
+    : BlockAtomic(nChannels, nChannels), nChannels_(nChannels),
+      linkSize_(linkSize), settings_(settings) {
+    if (linkSize_ == 0 || nChannels_ % linkSize_ != 0) {
+        throw invalid_operation_error(
+            "Channels must split into groups of linkSize");
+    }
+    prepare(ProcessSpec{});
+}
+
+void Dynamics::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    lookahead_ = lookaheadFrames(settings_.lookahead, sampleRate_);
+    const size_t nGroups = nChannels_ / linkSize_;
+    groups_.assign(nGroups, Group{});
+    minTargets_.assign(nGroups * (lookahead_ + 1), 0.0f);
+    minFrames_.assign(nGroups * (lookahead_ + 1), 0);
+    box_.assign(nGroups * std::max<size_t>(lookahead_, 1), 0.0f);
+    delays_.clear();
+    for (uint channel = 0; channel < nChannels_; ++channel) {
+        delays_.emplace_back(lookahead_ + 1, kSpan, spec.allocator);
+    }
+    gains_.assign(kSpan, 0.0f);
+    frameInputs_.assign(nChannels_, nullptr);
+    frameOutputs_.assign(nChannels_, nullptr);
+    frame_ = 0;
+    updateCoefficients();
+}
+
+size_t Dynamics::getRealtimeMemory(const ProcessSpec& spec) const {
+    size_t length = ShiftRegister<float>::getStorageLength(
+        lookaheadFrames(settings_.lookahead, spec.sampleRate) + 1, kSpan);
+    return nChannels_ *
+           RealtimeAllocator::getChunkSize(length * sizeof(float));
+}
+
+size_t Dynamics::getMemoryUsage() const {
+    size_t bytes = (minTargets_.size() + box_.size() + gains_.size()) *
+                       sizeof(float) +
+                   minFrames_.size() * sizeof(uint64_t) +
+                   groups_.size() * sizeof(Group);
+    for (const auto& delay : delays_) {
+        bytes += delay.getStorageLength() * sizeof(float);
+    }
+    return bytes;
+}
+
+void Dynamics::reset() {
+    std::fill(groups_.begin(), groups_.end(), Group{});
+    std::fill(box_.begin(), box_.end(), 0.0f);
+    for (auto& delay : delays_) {
+        delay.clear();
+    }
+    frame_ = 0;
+}
+
+void Dynamics::setParameter(uint index, float value) {
+    switch (index) {
+    case 0:
+        settings_.thresholdDb = value;
+        break;
+    case 1:
+        settings_.ratio = std::max(value, 1.0f);
+        break;
+    case 2:
+        settings_.kneeDb = std::max(value, 0.0f);
+        break;
+    case 3:
+        settings_.attack = std::max(value, 0.0f);
+        break;
+    case 4:
+        settings_.release = std::max(value, 0.0f);
+        break;
+    case 5:
+        settings_.makeupDb = value;
+        break;
+    default:
+        Block::setParameter(index, value);
+    }
+    updateCoefficients();
+}
+
+void Dynamics::updateCoefficients() {
+    attackCoefficient_ = smoothingCoefficient(settings_.attack, sampleRate_);
+    releaseCoefficient_ = smoothingCoefficient(settings_.release, sampleRate_);
+}
+
+void Dynamics::computeGains(uint group, InputBuffers_t inputs, size_t offset,
+                            size_t n) {
+    // Locals, which the outputs cannot alias
+    const float threshold = settings_.thresholdDb;
+    const float knee = std::max(settings_.kneeDb, 1e-3f);
+    const float slope = 1.0f / std::max(settings_.ratio, 1.0f) - 1.0f;
+    float level[kSpan];
+    float target[kSpan];
+    const float* first = inputs[group * linkSize_] + offset;
+    for (size_t j = 0; j < n; ++j) {
+        level[j] = std::max(std::fabs(first[j]), kLevelFloor);
+    }
+    for (uint c = 1; c < linkSize_; ++c) {
+        const float* x = inputs[group * linkSize_ + c] + offset;
+        for (size_t j = 0; j < n; ++j) {
+            level[j] = std::max(level[j], std::fabs(x[j]));
+        }
+    }
+    // Reduction in dB: none up to the knee, then quadratic, then linear
+    for (size_t j = 0; j < n; ++j) {
+        float over = kDbPerOctave * fastLog2(level[j]) - threshold;
+        float inKnee = std::min(std::max(over + 0.5f * knee, 0.0f), knee);
+        float curve = inKnee * inKnee / (2.0f * knee) +
+                      std::max(over - 0.5f * knee, 0.0f);
+        target[j] = slope * curve;
+    }
+    // Sliding minimum over lookahead_ + 1 frames, envelope, moving average
+    Group& state = groups_[group];
+    const size_t window = lookahead_ + 1;
+    const size_t boxLength = std::max<size_t>(lookahead_, 1);
+    float* minTargets = &minTargets_[group * window];
+    uint64_t* minFrames = &minFrames_[group * window];
+    float* box = &box_[group * boxLength];
+    const float attack = attackCoefficient_;
+    const float release = releaseCoefficient_;
+    // Ring indices stay below twice the window
+    auto wrap = [window](size_t i) { return i >= window ? i - window : i; };
+    for (size_t j = 0; j < n; ++j) {
+        const uint64_t frame = frame_ + j;
+        if (state.minCount > 0 && minFrames[state.minHead] + window <= frame) {
+            state.minHead = wrap(state.minHead + 1);
+            --state.minCount;
+        }
+        while (state.minCount > 0 &&
+               minTargets[wrap(state.minHead + state.minCount - 1)] >=
+                   target[j]) {
+            --state.minCount;
+        }
+        const size_t slot = wrap(state.minHead + state.minCount);
+        minTargets[slot] = target[j];
+        minFrames[slot] = frame;
+        ++state.minCount;
+        float minimum = minTargets[state.minHead];
+        float coefficient = minimum < state.envelope ? attack : release;
+        state.envelope = minimum + coefficient * (state.envelope - minimum);
+        state.sum += state.envelope - box[state.boxPosition];
+        box[state.boxPosition] = state.envelope;
+        if (++state.boxPosition == boxLength) {
+            state.boxPosition = 0;
+        }
+        gains_[j] = float(state.sum / double(boxLength));
+    }
+    // The release approaches 0 dB geometrically, down into denormals
+    state.envelope = flushToZero(state.envelope);
+    const float makeup = settings_.makeupDb;
+    float* gains = gains_.data();
+    for (size_t j = 0; j < n; ++j) {
+        gains[j] = fastExp2((gains[j] + makeup) * (1.0f / kDbPerOctave));
+    }
+}
+
+void Dynamics::evaluate() {
+    for (uint channel = 0; channel < nChannels_; ++channel) {
+        frameInputs_[channel] = &inputs_[channel];
+        frameOutputs_[channel] = &outputs_[channel];
+    }
+    evaluateBuffer(frameInputs_.data(), frameOutputs_.data(), 1);
+}
+
+void Dynamics::evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                              uint nFrames) {
+    for (size_t done = 0; done < nFrames; done += kSpan) {
+        const size_t n = std::min(kSpan, nFrames - done);
+        for (uint group = 0; group < groups_.size(); ++group) {
+            computeGains(group, inputs, done, n);
+            const float* gains = gains_.data();
+            for (uint c = 0; c < linkSize_; ++c) {
+                const uint channel = group * linkSize_ + c;
+                delays_[channel].write(inputs[channel] + done, n);
+                const float* delayed = delays_[channel].span(lookahead_, n);
+                float* output = outputs[channel] + done;
+                for (size_t j = 0; j < n; ++j) {
+                    output[j] = delayed[j] * gains[j];
+                }
+            }
+        }
+        frame_ += n;
+    }
+}
+
+std::shared_ptr<Block> Dynamics::clone() const {
+    return std::make_shared<Dynamics>(*this);
+}
+
+} // namespace blocks
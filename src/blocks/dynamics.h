@@ -0,0 +1,94 @@
+#ifndef BLOCKS_DYNAMICS_H
+#define BLOCKS_DYNAMICS_H
+
+#include "block.h"
+#include "processes/shift_register.h"
+
+namespace blocks {
+
+/*
+Settings of a Dynamics block. Levels above thresholdDb are reduced by
+ratio, an infinite ratio making a limiter, with a quadratic knee kneeDb
+wide. attack and release, in seconds, are the time constants of the gain
+going down and back up; lookahead, in seconds, delays the signal so the gain
+is down by the time a peak arrives.
+*/
+struct DynamicsSettings {
+    float thresholdDb = -12.0f;
+    float ratio = 4.0f;
+    float kneeDb = 6.0f;
+    float attack = 0.005f;
+    float release = 0.1f;
+    float lookahead = 0.0f;
+    float makeupDb = 0.0f;
+};
+
+/*
+Compressor and limiter for nChannels channels: input i is processed to
+output i. Channels are linked in groups of linkSize, e.g. stereo pairs at 2,
+sharing one gain driven by the loudest of them, so the image does not shift.
+
+Over the lookahead each group's gain follows the lowest gain any frame in
+it asks for, smoothed by a moving average as long as the lookahead. With a
+zero attack the gain thus reaches the target of every peak when it leaves
+the delay, never overshooting the ceiling of a limiter. Levels and gains
+are computed with polynomial approximations of log2 and exp2 in vectorized
+loops over whole buffers; only the envelope runs frame by frame.
+
+Parameters: 0 threshold in dB; 1 ratio; 2 knee in dB; 3 attack and
+4 release in seconds; 5 makeup gain in dB. The lookahead is fixed, and
+reported by getLatency().
+*/
+class Dynamics : public BlockAtomic {
+  public:
+    Dynamics(uint nChannels, DynamicsSettings settings, uint linkSize = 2);
+    void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    void prepare(const ProcessSpec& spec) override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    void reset() override;
+    void setParameter(uint index, float value) override;
+    uint getTailLength() const override { return uint(lookahead_); }
+    float getLatency() const override { return float(lookahead_); }
+    std::shared_ptr<Block> clone() const override;
+
+  private:
+    // Envelope of one group of linked channels
+    struct Group {
+        float envelope = 0.0f;
+        double sum = 0.0;
+        size_t boxPosition = 0;
+        // Window of the sliding minimum, a ring of increasing targets
+        size_t minHead = 0;
+        size_t minCount = 0;
+    };
+    void updateCoefficients();
+    void computeGains(uint group, InputBuffers_t inputs, size_t offset,
+                      size_t n);
+    uint nChannels_;
+    uint linkSize_;
+    DynamicsSettings settings_;
+    double sampleRate_ = kDefaultSampleRate;
+    size_t lookahead_ = 0;
+    float attackCoefficient_ = 0.0f;
+    float releaseCoefficient_ = 0.0f;
+    uint64_t frame_ = 0;
+    std::vector<Group> groups_;
+    // Per group: lookahead_ + 1 targets and their frames, and the moving
+    // average's lookahead_ (at least 1) latest gains
+    std::vector<float> minTargets_;
+    std::vector<uint64_t> minFrames_;
+    std::vector<float> box_;
+    std::vector<ShiftRegister<float>> delays_;
+    // Gains of the current chunk
+    std::vector<float> gains_;
+    std::vector<const float*> frameInputs_;
+    std::vector<float*> frameOutputs_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_DYNAMICS_H
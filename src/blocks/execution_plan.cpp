@@ -0,0 +1,657 @@
+#include "execution_plan.h"
+#include "denormals.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+
+namespace blocks {
+
+namespace {
+
+constexpr uint kZeroBuffer = 0;
+// Marks cell references until the number of scratch buffers is known
+constexpr uint kCellTag = 1u << 31;
+// Events per buffer that can be queued without allocating
+constexpr size_t kReservedEvents = 256;
+
+struct Value {
+    uint definedAt = 0;
+    uint lastUse = 0;
+    uint buffer = kZeroBuffer;
+    int cell = -1;
+};
+
+class BufferAllocator {
+  public:
+    uint acquire(uint value) {
+        uint buffer = 0;
+        if (freeBuffers_.empty()) {
+            buffer = uint(owners_.size());
+            owners_.emplace_back(value);
+        } else {
+            buffer = freeBuffers_.back();
+            freeBuffers_.pop_back();
+            owners_[buffer] = value;
+        }
+        return buffer;
+    }
+    void transfer(uint buffer, uint value) { owners_[buffer] = value; }
+    void release(uint buffer, uint value) {
+        if (buffer != kZeroBuffer && owners_[buffer] == value) {
+            freeBuffers_.emplace_back(buffer);
+        }
+    }
+    uint size() const { return uint(owners_.size()); }
+
+  private:
+    std::vector<uint> owners_{0};
+    std::vector<uint> freeBuffers_;
+};
+
+struct Source {
+    uint value = 0;
+    float gain = 1.0f;
+};
+
+// Sources feeding each input port of one block, summed when more than one
+using PortSources_t = std::vector<std::vector<Source>>;
+
+} // namespace
+
+ExecutionPlan compileExecutionPlan(const std::vector<uint>& sequence,
+                                   const Blocks_t& blocks,
+                                   const Connections_t& connections,
+                                   const std::vector<Port>& inputs,
+                                   const std::vector<Port>& outputs) {
+    ExecutionPlan plan;
+    // Bypassed blocks get no step; their inputs are wired straight through
+    for (uint blockIdx : sequence) {
+        if (!blocks[blockIdx]->isBypassed()) {
+            plan.sequence.emplace_back(blockIdx);
+        }
+    }
+    std::map<std::shared_ptr<Block>, uint> blockIndex;
+    for (uint i = 0; i < blocks.size(); ++i) {
+        blockIndex.emplace(blocks[i], i);
+    }
+    // Positions: 0 - system inputs, 1..n - blocks, n + 1 - system outputs
+    const uint nSteps = uint(plan.sequence.size());
+    std::vector<uint> position(blocks.size(), 0);
+    for (uint i = 0; i < nSteps; ++i) {
+        position[plan.sequence[i]] = i + 1;
+    }
+    // One value per system input and per block output port
+    std::vector<Value> values(inputs.size());
+    std::vector<int> producer(inputs.size(), -1);
+    std::vector<uint> firstOutputValue(blocks.size(), 0);
+    for (uint i = 0; i < blocks.size(); ++i) {
+        firstOutputValue[i] = uint(values.size());
+        for (uint port = 0; port < blocks[i]->getOutputSize(); ++port) {
+            Value value;
+            value.definedAt = value.lastUse = position[i];
+            values.emplace_back(value);
+            producer.emplace_back(int(i));
+        }
+    }
+    auto valueOf = [&](const Port& port) {
+        return firstOutputValue[blockIndex.at(port.block)] + port.port;
+    };
+    std::vector<PortSources_t> wired(blocks.size());
+    for (uint i = 0; i < blocks.size(); ++i) {
+        wired[i].resize(blocks[i]->getInputSize());
+    }
+    for (uint i = 0; i < inputs.size(); ++i) {
+        auto it = blockIndex.find(inputs[i].block);
+        if (it != blockIndex.end()) {
+            wired[it->second][inputs[i].port].emplace_back(Source{i});
+        }
+    }
+    for (const auto& [block, blockConnections] : connections) {
+        for (const auto& connection : blockConnections) {
+            uint target = blockIndex.at(connection.target.block);
+            wired[target][connection.target.port].emplace_back(
+                Source{valueOf(connection.source), connection.gain});
+        }
+    }
+    // Replaces outputs of bypassed blocks by whatever feeds the matching
+    // input port; ports without a matching input, and loops made only of
+    // bypassed blocks, are silent
+    std::vector<bool> splicing(blocks.size(), false);
+    std::function<void(Source, std::vector<Source>&)> splice =
+        [&](Source source, std::vector<Source>& result) {
+            int owner = producer[source.value];
+            if (owner < 0 || !blocks[owner]->isBypassed()) {
+                result.emplace_back(source);
+                return;
+            }
+            uint port = source.value - firstOutputValue[owner];
+            if (splicing[owner] || port >= wired[owner].size()) {
+                return;
+            }
+            splicing[owner] = true;
+            for (const auto& input : wired[owner][port]) {
+                splice(Source{input.value, input.gain * source.gain}, result);
+            }
+            splicing[owner] = false;
+        };
+    std::vector<PortSources_t> sources(blocks.size());
+    // Control-rate outputs are interpolated only where audio-rate code reads
+    std::vector<bool> feedsAudioRate(blocks.size(), false);
+    for (uint target : plan.sequence) {
+        sources[target].resize(wired[target].size());
+        for (uint port = 0; port < wired[target].size(); ++port) {
+            for (const auto& source : wired[target][port]) {
+                splice(source, sources[target][port]);
+            }
+            for (const auto& source : sources[target][port]) {
+                auto& value = values[source.value];
+                if (value.definedAt >= position[target]) {
+                    if (value.cell < 0) {
+                        value.cell = int(plan.nCells++);
+                    }
+                } else {
+                    value.lastUse = std::max(value.lastUse, position[target]);
+                }
+                if (producer[source.value] >= 0 &&
+                    blocks[target]->getRateDivisor() == 1) {
+                    feedsAudioRate[producer[source.value]] = true;
+                }
+            }
+        }
+    }
+    std::vector<std::vector<Source>> outputSources(outputs.size());
+    for (uint i = 0; i < outputs.size(); ++i) {
+        if (blockIndex.find(outputs[i].block) == blockIndex.end()) {
+            continue;
+        }
+        splice(Source{valueOf(outputs[i])}, outputSources[i]);
+        for (const auto& source : outputSources[i]) {
+            values[source.value].lastUse = nSteps + 1;
+            if (producer[source.value] >= 0) {
+                feedsAudioRate[producer[source.value]] = true;
+            }
+        }
+    }
+
+    // Greedy colouring in sequence order
+    BufferAllocator allocator;
+    std::vector<std::vector<uint>> expiring(nSteps + 2);
+    for (uint i = 0; i < inputs.size(); ++i) {
+        values[i].buffer = allocator.acquire(i);
+        plan.inputBuffers.emplace_back(values[i].buffer);
+        expiring[values[i].lastUse].emplace_back(i);
+    }
+    for (uint value : expiring[0]) {
+        allocator.release(values[value].buffer, value);
+    }
+    auto reference = [&](uint value, uint step) {
+        if (values[value].cell >= 0 && values[value].definedAt >= step) {
+            return kCellTag | uint(values[value].cell);
+        }
+        return values[value].buffer;
+    };
+    for (uint step = 1; step <= nSteps; ++step) {
+        uint blockIdx = plan.sequence[step - 1];
+        const auto& block = blocks[blockIdx];
+        PlanStep planStep;
+        planStep.block = blockIdx;
+        planStep.rateDivisor = block->getRateDivisor();
+        if (planStep.rateDivisor > 1) {
+            planStep.control = plan.nControls++;
+            planStep.interpolate = feedsAudioRate[blockIdx];
+        }
+        // Value read by each input port, -1 for unconnected ports
+        std::vector<int> portValues;
+        for (const auto& portSources : sources[blockIdx]) {
+            if (portSources.empty()) {
+                portValues.emplace_back(-1);
+            } else if (portSources.size() == 1 &&
+                       portSources[0].gain == 1.0f) {
+                portValues.emplace_back(int(portSources[0].value));
+            } else {
+                // Summing fan-in: the mix lives only for this step
+                Value mixValue;
+                mixValue.definedAt = mixValue.lastUse = step;
+                uint value = uint(values.size());
+                values.emplace_back(mixValue);
+                values[value].buffer = allocator.acquire(value);
+                expiring[step].emplace_back(value);
+                PlanMix mix;
+                mix.target = values[value].buffer;
+                for (const auto& source : portSources) {
+                    mix.sources.emplace_back(reference(source.value, step),
+                                             source.gain);
+                }
+                planStep.mixes.emplace_back(std::move(mix));
+                portValues.emplace_back(int(value));
+            }
+        }
+        for (int value : portValues) {
+            planStep.inputs.emplace_back(
+                value < 0 ? kZeroBuffer : reference(uint(value), step));
+        }
+        bool inPlace =
+            block->canProcessInPlace() && !portValues.empty() &&
+            portValues[0] >= 0 && (planStep.inputs[0] & kCellTag) == 0 &&
+            values[portValues[0]].lastUse == step &&
+            std::count(portValues.cbegin(), portValues.cend(),
+                       portValues[0]) == 1 &&
+            block->getOutputSize() > 0;
+        for (uint port = 0; port < block->getOutputSize(); ++port) {
+            uint value = firstOutputValue[blockIdx] + port;
+            if (port == 0 && inPlace) {
+                values[value].buffer = values[portValues[0]].buffer;
+                allocator.transfer(values[value].buffer, value);
+            } else {
+                values[value].buffer = allocator.acquire(value);
+            }
+            planStep.outputs.emplace_back(values[value].buffer);
+            if (values[value].cell >= 0) {
+                planStep.feedbackStores.emplace_back(values[value].buffer,
+                                                     values[value].cell);
+            }
+            expiring[values[value].lastUse].emplace_back(value);
+        }
+        for (uint value : expiring[step]) {
+            allocator.release(values[value].buffer, value);
+        }
+        plan.maxPorts = std::max({plan.maxPorts,
+                                  uint(planStep.inputs.size()),
+                                  uint(planStep.outputs.size())});
+        plan.steps.emplace_back(std::move(planStep));
+    }
+    for (const auto& portSources : outputSources) {
+        if (portSources.empty()) {
+            plan.outputBuffers.emplace_back(kZeroBuffer);
+        } else if (portSources.size() == 1 && portSources[0].gain == 1.0f) {
+            plan.outputBuffers.emplace_back(
+                values[portSources[0].value].buffer);
+        } else {
+            // Summed after the last step, e.g. around a bypassed block
+            PlanMix mix;
+            uint value = uint(values.size());
+            values.emplace_back();
+            mix.target = allocator.acquire(value);
+            for (const auto& source : portSources) {
+                mix.sources.emplace_back(values[source.value].buffer,
+                                         source.gain);
+            }
+            plan.outputBuffers.emplace_back(mix.target);
+            plan.outputMixes.emplace_back(std::move(mix));
+        }
+    }
+    plan.nBuffers = allocator.size();
+    // Feedback cells are addressed past the scratch buffers
+    auto resolve = [&plan](uint& reference) {
+        if ((reference & kCellTag) != 0) {
+            reference = plan.nBuffers + (reference & ~kCellTag);
+        }
+    };
+    for (auto& planStep : plan.steps) {
+        planStep.usesCells = !planStep.feedbackStores.empty();
+        for (auto& reference : planStep.inputs) {
+            planStep.usesCells |= (reference & kCellTag) != 0;
+            resolve(reference);
+        }
+        for (auto& mix : planStep.mixes) {
+            for (auto& source : mix.sources) {
+                planStep.usesCells |= (source.first & kCellTag) != 0;
+                resolve(source.first);
+            }
+        }
+    }
+    return plan;
+}
+
+void preparePlanState(const ExecutionPlan& plan, const Blocks_t& blocks,
+                      PlanState& state, uint maxFrames) {
+    state.maxFrames = std::max(maxFrames, 1u);
+    state.scratch.assign(size_t(plan.nBuffers) * state.maxFrames, 0.0f);
+    state.cells.assign(plan.nCells, 0.0f);
+    state.controls.assign(plan.nControls, ControlState());
+    state.events.reserve(kReservedEvents);
+    state.silent.assign(plan.nBuffers, false);
+    state.silent[kZeroBuffer] = true;
+    state.silentFrames.assign(plan.steps.size(), 0);
+    state.counters = std::make_shared<StepCounters>();
+    for (const auto& step : plan.steps) {
+        state.counters->blocks.emplace_back(blocks[step.block].get());
+    }
+    state.counters->denormals.resize(plan.steps.size());
+    state.counters->quarantines.resize(plan.steps.size());
+    for (const auto& step : plan.steps) {
+        if (step.rateDivisor > 1) {
+            auto& control = state.controls[step.control];
+            control.from.assign(step.outputs.size(), 0.0f);
+            control.to.assign(step.outputs.size(), 0.0f);
+        }
+    }
+    state.inputPointers.assign(plan.maxPorts, nullptr);
+    state.outputPointers.assign(plan.maxPorts, nullptr);
+}
+
+void resetPlanState(PlanState& state) {
+    std::fill(state.scratch.begin(), state.scratch.end(), 0.0f);
+    std::fill(state.cells.begin(), state.cells.end(), 0.0f);
+    for (auto& control : state.controls) {
+        control.phase = 0;
+        std::fill(control.from.begin(), control.from.end(), 0.0f);
+        std::fill(control.to.begin(), control.to.end(), 0.0f);
+    }
+    std::fill(state.silent.begin(), state.silent.end(), false);
+    if (!state.silent.empty()) {
+        state.silent[kZeroBuffer] = true;
+    }
+    std::fill(state.silentFrames.begin(), state.silentFrames.end(), 0);
+}
+
+namespace {
+
+/*
+Evaluates a control-rate block on the frames where its phase wraps. Reading
+input frame f before writing output frame f keeps in-place buffers valid.
+Cells are only read when stepping one frame at a time, so frame is then 0.
+*/
+template <typename Pointer_t>
+void runControlRate(const PlanStep& step, Block& block, PlanState& state,
+                    Pointer_t pointer, uint nFrames) {
+    auto& control = state.controls[step.control];
+    const uint nOutputs = uint(step.outputs.size());
+    for (uint frame = 0; frame < nFrames; ++frame) {
+        if (control.phase == 0) {
+            for (uint i = 0; i < step.inputs.size(); ++i) {
+                state.inputPointers[i] = pointer(step.inputs[i]) + frame;
+            }
+            std::copy_n(control.to.cbegin(), nOutputs, control.from.begin());
+            for (uint i = 0; i < nOutputs; ++i) {
+                state.outputPointers[i] = control.to.data() + i;
+            }
+            block.evaluateBuffer(state.inputPointers.data(),
+                                 state.outputPointers.data(), 1);
+        }
+        ++control.phase;
+        float position = step.interpolate ? float(control.phase) /
+                                                float(step.rateDivisor)
+                                          : 1.0f;
+        for (uint i = 0; i < nOutputs; ++i) {
+            pointer(step.outputs[i])[frame] =
+                control.from[i] + (control.to[i] - control.from[i]) * position;
+        }
+        if (control.phase == step.rateDivisor) {
+            control.phase = 0;
+        }
+    }
+}
+
+bool isSilent(const float* data, uint nFrames) {
+    return std::all_of(data, data + nFrames, [](float x) { return x == 0.0f; });
+}
+
+constexpr uint32_t kExponentBits = 0x7f800000u;
+constexpr uint32_t kMantissaBits = 0x007fffffu;
+
+uint32_t floatBits(float x) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+struct BufferScan {
+    bool silent = true;
+    bool subnormal = false;
+    bool nonFinite = false;
+};
+
+/*
+Classifies a block output in a single branch-free pass the compiler can
+vectorize. Tests the bits, as float comparisons read subnormals as zero while
+denormals-are-zero is on.
+*/
+BufferScan scanBuffer(const float* data, uint nFrames) {
+    uint32_t magnitudes = 0;
+    uint32_t subnormal = 0;
+    uint32_t nonFinite = 0;
+    for (uint i = 0; i < nFrames; ++i) {
+        uint32_t bits = floatBits(data[i]);
+        uint32_t exponent = bits & kExponentBits;
+        magnitudes |= bits & (kExponentBits | kMantissaBits);
+        subnormal |= uint32_t(exponent == 0) &
+                     uint32_t((bits & kMantissaBits) != 0);
+        nonFinite |= uint32_t(exponent == kExponentBits);
+    }
+    return BufferScan{magnitudes == 0, subnormal != 0, nonFinite != 0};
+}
+
+void flushSubnormals(float* data, uint nFrames) {
+    for (uint i = 0; i < nFrames; ++i) {
+        data[i] = (floatBits(data[i]) & kExponentBits) == 0 ? 0.0f : data[i];
+    }
+}
+
+// Frames a block must keep running after its inputs fall silent
+uint tailFrames(const Block& block, uint rateDivisor) {
+    uint tail = block.getTailLength();
+    if (tail >= kInfiniteTail / (rateDivisor + 1)) {
+        return kInfiniteTail;
+    }
+    // A control-rate block also finishes the ramp to its last value
+    return rateDivisor == 1 ? tail : (tail + 1) * rateDivisor;
+}
+
+void runSteps(const ExecutionPlan& plan, const Blocks_t& blocks,
+              PlanState& state, uint firstStep, uint lastStep, uint offset,
+              uint nFrames, uint eventOffset) {
+    auto pointer = [&](uint reference, uint frame) {
+        if (reference >= plan.nBuffers) {
+            return state.cells.data() + (reference - plan.nBuffers);
+        }
+        return state.scratch.data() + size_t(reference) * state.maxFrames +
+               frame;
+    };
+    // Flags of buffers filled from outside cover the whole run, so single
+    // frames stepped through feedback loops are checked directly
+    auto silent = [&](uint reference) {
+        if (reference >= plan.nBuffers || nFrames == 1) {
+            return *pointer(reference, offset) == 0.0f;
+        }
+        return state.silent[reference] != 0;
+    };
+    auto runMix = [&](const PlanMix& mix) {
+        float* target = pointer(mix.target, offset);
+        bool mixSilent = std::all_of(
+            mix.sources.cbegin(), mix.sources.cend(),
+            [&](const auto& source) { return silent(source.first); });
+        state.silent[mix.target] = mixSilent;
+        if (mixSilent) {
+            std::fill_n(target, nFrames, 0.0f);
+            return;
+        }
+        const auto& [first, firstGain] = mix.sources.front();
+        const float* source = pointer(first, offset);
+        for (uint frame = 0; frame < nFrames; ++frame) {
+            target[frame] = source[frame] * firstGain;
+        }
+        for (uint i = 1; i < mix.sources.size(); ++i) {
+            const auto& [reference, gain] = mix.sources[i];
+            source = pointer(reference, offset);
+            for (uint frame = 0; frame < nFrames; ++frame) {
+                target[frame] += source[frame] * gain;
+            }
+        }
+    };
+    // Runs one step's block over frames [start, start + length)
+    auto evaluate = [&](const PlanStep& step, uint start, uint length) {
+        auto at = [&](uint reference) { return pointer(reference, start); };
+        if (step.rateDivisor > 1) {
+            runControlRate(step, *blocks[step.block], state, at, length);
+            return;
+        }
+        for (uint i = 0; i < step.inputs.size(); ++i) {
+            state.inputPointers[i] = at(step.inputs[i]);
+        }
+        for (uint i = 0; i < step.outputs.size(); ++i) {
+            state.outputPointers[i] = at(step.outputs[i]);
+        }
+        blocks[step.block]->evaluateBuffer(state.inputPointers.data(),
+                                           state.outputPointers.data(),
+                                           length);
+    };
+    const uint end = offset + nFrames;
+    auto pendingEvent = [&](uint block) {
+        return std::any_of(state.events.cbegin(), state.events.cend(),
+                           [&](const PlanEvent& event) {
+                               return event.block == block &&
+                                      event.offset >= eventOffset + offset &&
+                                      event.offset < eventOffset + end;
+                           });
+    };
+    for (uint stepIdx = firstStep; stepIdx < lastStep; ++stepIdx) {
+        const auto& step = plan.steps[stepIdx];
+        const auto& block = *blocks[step.block];
+        for (const auto& mix : step.mixes) {
+            runMix(mix);
+        }
+        // Sources without inputs never count as silent
+        bool inputsSilent =
+            !step.inputs.empty() &&
+            std::all_of(step.inputs.cbegin(), step.inputs.cend(), silent) &&
+            !pendingEvent(step.block);
+        uint& silentFrames = state.silentFrames[stepIdx];
+        bool suspended = block.isSuspended();
+        if (suspended ||
+            (inputsSilent &&
+             silentFrames >= tailFrames(block, step.rateDivisor))) {
+            // Switched off under load: input 0 passes on to output 0
+            bool passThrough =
+                suspended && !step.inputs.empty() && !step.outputs.empty();
+            if (passThrough) {
+                const float* source = pointer(step.inputs.front(), offset);
+                float* target = pointer(step.outputs.front(), offset);
+                if (source != target) {
+                    std::copy_n(source, nFrames, target);
+                }
+                state.silent[step.outputs.front()] = silent(step.inputs[0]);
+            }
+            for (uint i = passThrough ? 1 : 0; i < step.outputs.size(); ++i) {
+                std::fill_n(pointer(step.outputs[i], offset), nFrames, 0.0f);
+                state.silent[step.outputs[i]] = true;
+            }
+            if (step.rateDivisor > 1) {
+                auto& control = state.controls[step.control];
+                control.phase = 0;
+                std::fill(control.from.begin(), control.from.end(), 0.0f);
+                std::fill(control.to.begin(), control.to.end(), 0.0f);
+            }
+        } else {
+            silentFrames =
+                inputsSilent ? std::min(silentFrames, kInfiniteTail - nFrames) +
+                                   nFrames
+                             : 0;
+            uint start = offset;
+            for (const auto& event : state.events) {
+                if (event.block != step.block ||
+                    event.offset < eventOffset + start) {
+                    continue;
+                }
+                uint frame = event.offset - eventOffset;
+                if (frame >= end) {
+                    break;
+                }
+                if (frame > start) {
+                    evaluate(step, start, frame - start);
+                    start = frame;
+                }
+                blocks[step.block]->setParameter(event.parameter, event.value);
+            }
+            if (start < end) {
+                evaluate(step, start, end - start);
+            }
+            bool denormal = false;
+            bool nonFinite = false;
+            for (uint buffer : step.outputs) {
+                float* data = pointer(buffer, offset);
+                auto scan = scanBuffer(data, nFrames);
+                if (scan.subnormal) {
+                    flushSubnormals(data, nFrames);
+                    denormal = true;
+                }
+                state.silent[buffer] = scan.silent;
+                nonFinite |= scan.nonFinite;
+            }
+            if (denormal) {
+                state.counters->denormals[stepIdx].increment();
+            }
+            if (nonFinite && block.hasNonFiniteGuard()) {
+                // Quarantine: mute this run and start the block afresh
+                for (uint buffer : step.outputs) {
+                    std::fill_n(pointer(buffer, offset), nFrames, 0.0f);
+                    state.silent[buffer] = true;
+                }
+                blocks[step.block]->reset();
+                state.counters->quarantines[stepIdx].increment();
+            }
+        }
+        for (const auto& [buffer, cell] : step.feedbackStores) {
+            state.cells[cell] = flushToZero(*pointer(buffer, offset));
+        }
+    }
+    if (lastStep == plan.steps.size()) {
+        for (const auto& mix : plan.outputMixes) {
+            runMix(mix);
+        }
+    }
+}
+
+} // namespace
+
+void runPlanSteps(const ExecutionPlan& plan, const Blocks_t& blocks,
+                  PlanState& state, uint firstStep, uint lastStep,
+                  uint nFrames, uint eventOffset) {
+    bool usesCells =
+        std::any_of(plan.steps.cbegin() + firstStep,
+                    plan.steps.cbegin() + lastStep,
+                    [](const PlanStep& step) { return step.usesCells; });
+    if (usesCells) {
+        for (uint frame = 0; frame < nFrames; ++frame) {
+            runSteps(plan, blocks, state, firstStep, lastStep, frame, 1,
+                     eventOffset);
+        }
+    } else {
+        runSteps(plan, blocks, state, firstStep, lastStep, 0, nFrames,
+                 eventOffset);
+    }
+}
+
+void updateSilence(PlanState& state, uint buffer, uint nFrames) {
+    state.silent[buffer] = isSilent(bufferData(state, buffer), nFrames);
+}
+
+void executePlan(const ExecutionPlan& plan, const Blocks_t& blocks,
+                 PlanState& state, InputBuffers_t inputs,
+                 OutputBuffers_t outputs, uint nFrames) {
+    if (state.scratch.size() < size_t(plan.nBuffers) * state.maxFrames ||
+        state.cells.size() < plan.nCells) {
+        throw invalid_operation_error(
+            "Plan state was not prepared for this execution plan");
+    }
+    for (uint done = 0; done < nFrames;) {
+        uint length = std::min(nFrames - done, state.maxFrames);
+        for (uint i = 0; i < plan.inputBuffers.size(); ++i) {
+            std::copy_n(inputs[i] + done, length,
+                        bufferData(state, plan.inputBuffers[i]));
+            updateSilence(state, plan.inputBuffers[i], length);
+        }
+        runPlanSteps(plan, blocks, state, 0, uint(plan.steps.size()), length,
+                     done);
+        for (uint i = 0; i < plan.outputBuffers.size(); ++i) {
+            std::copy_n(bufferData(state, plan.outputBuffers[i]), length,
+                        outputs[i] + done);
+        }
+        done += length;
+    }
+}
+
+} // namespace blocks
@@ -0,0 +1,168 @@
+#ifndef BLOCKS_EXECUTION_PLAN_H
+#define BLOCKS_EXECUTION_PLAN_H
+
+#include "block_system.h"
+#include "evaluation_sequence.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace blocks {
+
+/*
+Index-based, compiled form of a block system. Every value travelling through
+the graph lives in a scratch buffer; buffers are assigned by a liveness
+analysis over the evaluation sequence, so values whose lifetimes do not
+overlap share memory. Buffer 0 is always silent and is read by unconnected
+input ports. Input ports fed by several connections, or by a connection with a
+gain, read a mix buffer summed just before their block runs.
+
+Buffer references at or above nBuffers denote feedback cells: single samples
+carrying a value from a block evaluated later in the sequence. A plan with
+feedback cells is executed one frame at a time.
+
+Steps with a rate divisor above one evaluate their block once per divisor
+frames and fill their output buffers from the two latest results.
+
+Bypassed blocks get no step: readers of their outputs read whatever feeds the
+matching input ports. System outputs needing a sum are mixed after the last
+step.
+
+Subnormal samples in block outputs are counted per step and flushed, and
+values stored into feedback cells are flushed below kFlushThreshold. Guarded
+blocks emitting NaN or Inf are muted for the run and reset.
+
+While running, each buffer carries a flag telling whether the frames just
+computed are silent. A step whose inputs have been silent for longer than its
+block's tail is skipped and writes silence instead.
+*/
+struct PlanMix {
+    uint target = 0;
+    std::vector<std::pair<uint, float>> sources; // (buffer, gain)
+};
+
+struct PlanStep {
+    uint block = 0;
+    std::vector<PlanMix> mixes;
+    std::vector<uint> inputs;
+    std::vector<uint> outputs;
+    std::vector<std::pair<uint, uint>> feedbackStores; // (buffer, cell)
+    bool usesCells = false;
+    uint rateDivisor = 1;
+    uint control = 0;         // index of the step's ControlState
+    bool interpolate = false; // ramp outputs, some reader runs at audio rate
+};
+
+struct ExecutionPlan {
+    std::vector<uint> sequence;
+    std::vector<PlanStep> steps;
+    std::vector<uint> inputBuffers;
+    std::vector<uint> outputBuffers;
+    uint nBuffers = 1;
+    uint nCells = 0;
+    std::vector<PlanMix> outputMixes;
+    uint maxPorts = 0;
+    uint nControls = 0;
+};
+
+struct ControlState {
+    uint phase = 0; // frames since the block last ran
+    std::vector<float> from;
+    std::vector<float> to;
+};
+
+struct PlanEvent {
+    uint offset = 0; // frame within the buffer passed to executePlan()
+    uint block = 0;
+    uint parameter = 0;
+    float value = 0.0f;
+};
+
+/*
+Counter written by the processing thread and readable from any other. Copies
+take a snapshot of the count.
+*/
+class RelaxedCounter {
+  public:
+    RelaxedCounter() = default;
+    RelaxedCounter(const RelaxedCounter& other) : count_(other.get()) {}
+    RelaxedCounter& operator=(const RelaxedCounter& other) {
+        count_.store(other.get(), std::memory_order_relaxed);
+        return *this;
+    }
+    // Single writer, so no read-modify-write instruction is needed
+    void increment() {
+        count_.store(count_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    }
+    uint get() const { return count_.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint> count_{0};
+};
+
+/*
+Health counters of one prepared plan, with the block each step runs. They
+are allocated apart from the rest of the state so that other threads can
+hold on to them while the processing thread switches plans; blocks are
+kept for identification only and never dereferenced.
+*/
+struct StepCounters {
+    std::vector<const Block*> blocks;
+    std::vector<RelaxedCounter> denormals; // per step, runs with subnormals
+    std::vector<RelaxedCounter> quarantines; // per step, NaN/Inf outputs
+};
+
+struct PlanState {
+    uint maxFrames = 0;
+    std::vector<float> scratch;
+    std::vector<float> cells;
+    std::vector<ControlState> controls;
+    std::vector<PlanEvent> events; // pending for the current executePlan()
+    std::vector<char> silent;      // per buffer, for the frames being run
+    std::vector<uint> silentFrames; // per step, since an input was audible
+    std::shared_ptr<StepCounters> counters;
+    std::vector<const float*> inputPointers;
+    std::vector<float*> outputPointers;
+};
+
+ExecutionPlan compileExecutionPlan(const std::vector<uint>& sequence,
+                                   const Blocks_t& blocks,
+                                   const Connections_t& connections,
+                                   const std::vector<Port>& inputs,
+                                   const std::vector<Port>& outputs);
+
+// Allocates state for running plan over blocks, with counters at zero
+void preparePlanState(const ExecutionPlan& plan, const Blocks_t& blocks,
+                      PlanState& state, uint maxFrames);
+
+// Clears processing state in place, without allocating
+void resetPlanState(PlanState& state);
+
+inline float* bufferData(PlanState& state, uint buffer) {
+    return state.scratch.data() + size_t(buffer) * state.maxFrames;
+}
+
+/*
+Sets the silence flag of a buffer filled from outside the plan, e.g. with
+system inputs, from its first nFrames.
+*/
+void updateSilence(PlanState& state, uint buffer, uint nFrames);
+
+/*
+Runs steps [firstStep, lastStep) over the first nFrames of the scratch
+buffers; ranges touching feedback cells are stepped frame by frame. Events
+in state.events at offsets [eventOffset, eventOffset + nFrames) are applied
+on their frames, splitting only the blocks they target.
+*/
+void runPlanSteps(const ExecutionPlan& plan, const Blocks_t& blocks,
+                  PlanState& state, uint firstStep, uint lastStep,
+                  uint nFrames, uint eventOffset = 0);
+
+void executePlan(const ExecutionPlan& plan, const Blocks_t& blocks,
+                 PlanState& state, InputBuffers_t inputs,
+                 OutputBuffers_t outputs, uint nFrames);
+
+} // namespace blocks
+
+#endif // BLOCKS_EXECUTION_PLAN_H
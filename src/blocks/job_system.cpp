@@ -0,0 +1,115 @@
+#include "job_system.h"
+#include "exceptions.h"
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+namespace blocks {
+
+namespace {
+
+// How often idle workers free what dispatched commits swapped out
+constexpr std::chrono::milliseconds kRecyclePeriod{50};
+
+} // namespace
+
+JobSystem::JobSystem(uint nThreads, uint queueCapacity) {
+    if (nThreads == 0 || queueCapacity == 0) {
+        throw invalid_operation_error(
+            "Job system needs at least one thread and one queue slot");
+    }
+    for (uint i = 0; i < nThreads; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->commits = std::make_unique<SpscRing<Commit_t>>(queueCapacity);
+        workers_.emplace_back(std::move(worker));
+    }
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&JobSystem::workerLoop, this,
+                                     std::ref(*worker));
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wakeWorkers_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void JobSystem::submit(Job_t job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.emplace_back(std::move(job));
+    }
+    wakeWorkers_.notify_one();
+}
+
+uint JobSystem::dispatch() {
+    uint count = 0;
+    for (auto& worker : workers_) {
+        while (Commit_t* commit = worker->commits->beginRead()) {
+            try {
+                if (*commit) {
+                    (*commit)();
+                }
+            } catch (...) {
+                worker->commits->endRead();
+                throw;
+            }
+            worker->commits->endRead();
+            ++count;
+        }
+    }
+    return count;
+}
+
+void JobSystem::waitUntilBuilt() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    built_.wait(lock, [this] { return jobs_.empty() && running_ == 0; });
+}
+
+void JobSystem::workerLoop(Worker& worker) {
+    auto& commits = *worker.commits;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wakeWorkers_.wait_for(lock, kRecyclePeriod,
+                              [this] { return stop_ || !jobs_.empty(); });
+        lock.unlock();
+        commits.recycle(Commit_t());
+        lock.lock();
+        if (stop_) {
+            return;
+        }
+        if (jobs_.empty()) {
+            continue;
+        }
+        Job_t job = std::move(jobs_.front());
+        jobs_.pop_front();
+        ++running_;
+        lock.unlock();
+        Commit_t commit;
+        try {
+            commit = job();
+        } catch (const std::exception& e) {
+            spdlog::error("Background job failed: {}", e.what());
+        }
+        job = nullptr;
+        Commit_t* slot = commits.beginWrite();
+        while (slot == nullptr) {
+            // The processing thread has not dispatched for a while
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            commits.recycle(Commit_t());
+            slot = commits.beginWrite();
+        }
+        *slot = std::move(commit);
+        commits.endWrite();
+        lock.lock();
+        --running_;
+        built_.notify_all();
+    }
+}
+
+} // namespace blocks
@@ -0,0 +1,61 @@
+#ifndef BLOCKS_JOB_SYSTEM_H
+#define BLOCKS_JOB_SYSTEM_H
+
+#include "spsc_ring.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace blocks {
+
+/*
+Worker threads for work that must never run on the processing thread:
+reallocating delay lines, building FFT plans, loading impulse responses,
+recompiling plans. A job runs on a worker and returns a commit, a cheap
+closure that switches its result in. Commits wait in lock-free queues, one per
+worker, until the processing thread calls dispatch(), typically at the start
+of a buffer.
+
+A commit must only swap pointers or values; whatever it swaps out should be
+left in its captures. Captures are destroyed on the worker when the queue
+slot is reused, never on the processing thread. Jobs are submitted from
+non-real-time threads; dispatch() is called by a single processing thread.
+*/
+class JobSystem {
+  public:
+    using Commit_t = std::function<void()>;
+    using Job_t = std::function<Commit_t()>;
+
+    explicit JobSystem(uint nThreads = 1, uint queueCapacity = 16);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    void submit(Job_t job);
+    // Runs the commits of finished jobs; returns how many ran
+    uint dispatch();
+    // Blocks until every submitted job has finished (not necessarily
+    // committed); for non-real-time threads
+    void waitUntilBuilt();
+
+  private:
+    struct Worker {
+        std::unique_ptr<SpscRing<Commit_t>> commits;
+        std::thread thread;
+    };
+    void workerLoop(Worker& worker);
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex mutex_;
+    std::condition_variable wakeWorkers_;
+    std::condition_variable built_;
+    std::deque<Job_t> jobs_;
+    uint running_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_JOB_SYSTEM_H
@@ -0,0 +1,108 @@
+#include "load_governor.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <chrono>
+
+namespace blocks {
+
+LoadGovernor::LoadGovernor(std::shared_ptr<BlockSystem> system,
+                           LoadPolicy policy)
+    : system_(system), policy_(policy) {
+    if (!(policy.restoreBelow < policy.degradeAbove) ||
+        !(policy.smoothing > 0.0f && policy.smoothing <= 1.0f)) {
+        throw invalid_operation_error("Invalid load policy");
+    }
+    auto blocks = system_->viewBlocks();
+    std::stable_sort(blocks.begin(), blocks.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                         return lhs->getCostEstimate() /
+                                    float(lhs->getRateDivisor()) >
+                                rhs->getCostEstimate() /
+                                    float(rhs->getRateDivisor());
+                     });
+    auto fallbacks = [](const Block& block) {
+        return block.getQualityLevelCount() - 1 -
+               (block.isBypassableUnderLoad() ? 1 : 0);
+    };
+    uint maxFallbacks = 0;
+    for (const auto& block : blocks) {
+        maxFallbacks = std::max(maxFallbacks, fallbacks(*block));
+    }
+    // Round by round, so no block drops far below the others
+    for (uint level = 1; level <= maxFallbacks; ++level) {
+        for (const auto& block : blocks) {
+            if (level <= fallbacks(*block)) {
+                ladder_.push_back({block, level});
+            }
+        }
+    }
+    for (const auto& block : blocks) {
+        if (block->isBypassableUnderLoad()) {
+            ladder_.push_back({block, fallbacks(*block) + 1});
+        }
+    }
+}
+
+void LoadGovernor::evaluateBuffer(InputBuffers_t inputs,
+                                  OutputBuffers_t outputs, uint nFrames) {
+    auto start = std::chrono::steady_clock::now();
+    system_->evaluateBuffer(inputs, outputs, nFrames);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    update(elapsed.count(), nFrames);
+}
+
+void LoadGovernor::update(double seconds, uint nFrames) {
+    if (nFrames == 0) {
+        return;
+    }
+    double deadline = double(nFrames) / system_->getProcessSpec().sampleRate;
+    float load = getLoad();
+    load += policy_.smoothing * (float(seconds / deadline) - load);
+    load_.store(load, std::memory_order_relaxed);
+    uint degradation = getDegradation();
+    if (settleBuffers_ > 0) {
+        --settleBuffers_;
+    }
+    if (load > policy_.degradeAbove) {
+        calmBuffers_ = 0;
+        if (settleBuffers_ == 0 && degradation < ladder_.size()) {
+            // Rungs of bypassed blocks save nothing; they are taken along
+            // with the next one that does, without waiting to settle
+            bool saved = false;
+            while (degradation < ladder_.size() && !saved) {
+                const auto& rung = ladder_[degradation++];
+                rung.block->setQualityLevel(rung.level);
+                saved = !rung.block->isBypassed();
+            }
+            degradation_.store(degradation, std::memory_order_relaxed);
+            if (saved) {
+                settleBuffers_ = policy_.settleBuffers;
+            }
+        }
+    } else if (load < policy_.restoreBelow) {
+        if (++calmBuffers_ >= policy_.restoreAfter && degradation > 0) {
+            // Undoes a rung; true unless its block is bypassed
+            auto restore = [&] {
+                const auto& rung = ladder_[--degradation];
+                rung.block->setQualityLevel(rung.level - 1);
+                return !rung.block->isBypassed();
+            };
+            bool restored = false;
+            while (degradation > 0 && !restored) {
+                restored = restore();
+            }
+            // and the bypassed rungs that were taken along with it
+            while (degradation > 0 &&
+                   ladder_[degradation - 1].block->isBypassed()) {
+                restore();
+            }
+            degradation_.store(degradation, std::memory_order_relaxed);
+            calmBuffers_ = 0;
+        }
+    } else {
+        calmBuffers_ = 0;
+    }
+}
+
+} // namespace blocks
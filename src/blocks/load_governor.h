@@ -0,0 +1,70 @@
+#ifndef BLOCKS_LOAD_GOVERNOR_H
+#define BLOCKS_LOAD_GOVERNOR_H
+
+#include "block_system.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace blocks {
+
+/*
+Thresholds are fractions of the deadline, i.e. of nFrames / sampleRate.
+*/
+struct LoadPolicy {
+    float degradeAbove = 0.85f;
+    float restoreBelow = 0.5f;
+    // Buffers the load must stay below restoreBelow before quality returns
+    uint restoreAfter = 64;
+    // Buffers to wait after stepping down before stepping down again
+    uint settleBuffers = 8;
+    // Weight of the newest measurement in the smoothed load
+    float smoothing = 0.1f;
+};
+
+/*
+Trades quality for CPU time instead of missing deadlines. Each buffer is timed
+and, while the smoothed load stays above policy.degradeAbove, the system's
+blocks step down one quality level at a time: first every block's own
+fallbacks, the most expensive blocks first, and only then blocks that allow
+being bypassed under load. Quality comes back in reverse order once the load
+has stayed below policy.restoreBelow.
+
+The ladder is built from the system's blocks on construction, so build the
+graph first. Rungs of blocks that are bypassed when they come up are passed
+over, so bypassing a block later needs no new ladder. Quality levels change
+on the thread calling evaluateBuffer(); only getLoad() and getDegradation()
+may be called from other threads.
+*/
+class LoadGovernor {
+  public:
+    LoadGovernor(std::shared_ptr<BlockSystem> system,
+                 LoadPolicy policy = LoadPolicy());
+    // Evaluates the system and accounts for the time it took
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames);
+    // Applies the policy to one buffer of nFrames that took `seconds`
+    void update(double seconds, uint nFrames);
+    float getLoad() const { return load_.load(std::memory_order_relaxed); }
+    uint getDegradation() const {
+        return degradation_.load(std::memory_order_relaxed);
+    }
+    uint getMaxDegradation() const { return uint(ladder_.size()); }
+
+  private:
+    struct Rung {
+        std::shared_ptr<Block> block;
+        uint level = 0;
+    };
+    std::shared_ptr<BlockSystem> system_;
+    LoadPolicy policy_;
+    std::vector<Rung> ladder_;
+    std::atomic<float> load_{0.0f};
+    std::atomic<uint> degradation_{0};
+    uint calmBuffers_ = 0;
+    uint settleBuffers_ = 0;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_LOAD_GOVERNOR_H
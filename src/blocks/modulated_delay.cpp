@@ -0,0 +1,159 @@
+#include "modulated_delay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace blocks {
+
+namespace {
+
+// Frames whose read positions are computed and gathered per pass
+constexpr size_t kSpan = 256;
+
+// Whole samples up to the longest delay, plus the neighbours Hermite reads
+size_t lineLength(float maxTime, double sampleRate) {
+    return size_t(std::ceil(double(maxTime) * sampleRate)) + 3;
+}
+
+/*
+The base delay in samples, to 1/65536 of a sample: times meant as whole
+samples, which seconds in float rarely hit exactly, read without blending.
+*/
+float toSamples(float time, double sampleRate) {
+    return float(std::round(double(time) * sampleRate * 65536.0) / 65536.0);
+}
+
+} // namespace
+
+ModulatedDelay::ModulatedDelay(float time, float maxTime,
+                               Interpolation interpolation)
+    : BlockAtomic(2, 1), time_(std::max(time, 0.0f)),
+      maxTime_(std::max(maxTime, time_)), interpolation_(interpolation),
+      line_(0) {
+    prepare(ProcessSpec{});
+}
+
+void ModulatedDelay::evaluate() {
+    processChunk(&inputs_[0], &inputs_[1], &outputs_[0], 1);
+}
+
+void ModulatedDelay::evaluateBuffer(InputBuffers_t inputs,
+                                    OutputBuffers_t outputs, uint nFrames) {
+    for (size_t done = 0; done < nFrames; done += kSpan) {
+        processChunk(inputs[0] + done, inputs[1] + done, outputs[0] + done,
+                     std::min(kSpan, nFrames - done));
+    }
+}
+
+void ModulatedDelay::processChunk(const float* input, const float* modulation,
+                                  float* output, size_t n) {
+    // Read positions first: modulation may share a buffer with the output
+    const float rate = float(sampleRate_);
+    const float minDelay = interpolation_ == Interpolation::Linear    ? 0.0f
+                           : interpolation_ == Interpolation::Hermite ? 1.0f
+                                                                      : 0.5f;
+    // The allpass works best delaying between half a sample and one and a half
+    const float offset = interpolation_ == Interpolation::Allpass ? 0.5f : 0.0f;
+    uint32_t index[kSpan];
+    float fraction[kSpan];
+    for (size_t frame = 0; frame < n; ++frame) {
+        float delay = std::fmin(
+            std::fmax(delaySamples_ + modulation[frame] * rate, minDelay),
+            maxSamples_);
+        float whole = std::floor(delay - offset);
+        fraction[frame] = delay - whole;
+        // Frame i sits n - 1 - i samples behind the newest of the chunk
+        index[frame] = uint32_t(whole) + uint32_t(n - 1 - frame);
+    }
+    line_.write(input, n);
+
+    uint32_t shifted[kSpan];
+    auto gather = [&](uint32_t step, float* taps) {
+        for (size_t frame = 0; frame < n; ++frame) {
+            shifted[frame] = index[frame] + step;
+        }
+        line_.gather(shifted, taps, n);
+    };
+    // Taps from newest to oldest around each read position
+    float taps[4][kSpan];
+    switch (interpolation_) {
+    case Interpolation::Linear:
+        line_.gather(index, taps[0], n);
+        gather(1, taps[1]);
+        for (size_t frame = 0; frame < n; ++frame) {
+            float current = taps[0][frame];
+            float next = taps[1][frame];
+            output[frame] = current + fraction[frame] * (next - current);
+        }
+        break;
+    case Interpolation::Hermite:
+        gather(uint32_t(-1), taps[0]);
+        line_.gather(index, taps[1], n);
+        gather(1, taps[2]);
+        gather(2, taps[3]);
+        for (size_t frame = 0; frame < n; ++frame) {
+            float previous = taps[0][frame];
+            float current = taps[1][frame];
+            float next = taps[2][frame];
+            float after = taps[3][frame];
+            float c1 = 0.5f * (next - previous);
+            float c2 = previous - 2.5f * current + 2.0f * next - 0.5f * after;
+            float c3 = 0.5f * (after - previous) + 1.5f * (current - next);
+            float x = fraction[frame];
+            output[frame] = ((c3 * x + c2) * x + c1) * x + current;
+        }
+        break;
+    case Interpolation::Allpass:
+        line_.gather(index, taps[0], n);
+        gather(1, taps[1]);
+        for (size_t frame = 0; frame < n; ++frame) {
+            float eta = (1.0f - fraction[frame]) / (1.0f + fraction[frame]);
+            allpassState_ = eta * (taps[0][frame] - allpassState_) +
+                            taps[1][frame];
+            output[frame] = allpassState_;
+        }
+        break;
+    }
+}
+
+void ModulatedDelay::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    maxSamples_ = float(double(maxTime_) * sampleRate_);
+    delaySamples_ = toSamples(time_, sampleRate_);
+    line_ = ShiftRegister<float>(lineLength(maxTime_, sampleRate_), kSpan,
+                                 spec.allocator);
+    allpassState_ = 0.0f;
+}
+
+void ModulatedDelay::reset() {
+    line_.clear();
+    allpassState_ = 0.0f;
+}
+
+size_t ModulatedDelay::getRealtimeMemory(const ProcessSpec& spec) const {
+    size_t length = ShiftRegister<float>::getStorageLength(
+        lineLength(maxTime_, spec.sampleRate), kSpan);
+    return RealtimeAllocator::getChunkSize(length * sizeof(float));
+}
+
+size_t ModulatedDelay::getMemoryUsage() const {
+    return line_.getStorageLength() * sizeof(float);
+}
+
+void ModulatedDelay::setParameter(uint index, float value) {
+    if (index != 0) {
+        Block::setParameter(index, value);
+    }
+    time_ = std::clamp(value, 0.0f, maxTime_);
+    delaySamples_ = toSamples(time_, sampleRate_);
+}
+
+uint ModulatedDelay::getTailLength() const {
+    return uint(std::ceil(maxSamples_)) + 1;
+}
+
+std::shared_ptr<Block> ModulatedDelay::clone() const {
+    return std::make_shared<ModulatedDelay>(*this);
+}
+
+} // namespace blocks
@@ -0,0 +1,64 @@
+#ifndef BLOCKS_MODULATED_DELAY_H
+#define BLOCKS_MODULATED_DELAY_H
+
+#include "block.h"
+#include "processes/shift_register.h"
+
+namespace blocks {
+
+/*
+How a delay between two whole samples is read:
+- Linear blends the two neighbouring samples; cheap, but dulls the highs at
+  fractional delays. Delays down to 0 samples.
+- Hermite fits a cubic through four samples; flatter response for a little
+  more work. Delays down to 1 sample.
+- Allpass runs a first-order allpass over two samples, keeping the full
+  magnitude response. Being recursive it suits slow modulation; fast sweeps
+  may click where the whole part of the delay steps. Delays down to half a
+  sample.
+*/
+enum class Interpolation { Linear, Hermite, Allpass };
+
+/*
+Delays input 0 by a time in seconds that may fall between samples: the base
+time (parameter 0) plus input 1, the modulation, read per frame. Chorus,
+flanger and vibrato feed an oscillator into the modulation port.
+
+The total is clamped to maxTime (at least time), for which the line is sized
+in prepare(), and to the shortest delay the interpolation supports.
+Buffers are read in two passes: read positions for the whole chunk first,
+then the samples around them are gathered and interpolated in bulk.
+*/
+class ModulatedDelay : public BlockAtomic {
+  public:
+    ModulatedDelay(float time, float maxTime = 0.0f,
+                   Interpolation interpolation = Interpolation::Linear);
+    void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    // Parameter 0: base delay time in seconds
+    void setParameter(uint index, float value) override;
+    uint getTailLength() const override;
+    std::shared_ptr<Block> clone() const override;
+
+  private:
+    void processChunk(const float* input, const float* modulation,
+                      float* output, size_t n);
+    float time_;
+    float maxTime_;
+    Interpolation interpolation_;
+    double sampleRate_ = kDefaultSampleRate;
+    float delaySamples_ = 0.0f;
+    float maxSamples_ = 0.0f;
+    float allpassState_ = 0.0f;
+    ShiftRegister<float> line_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_MODULATED_DELAY_H
@@ -0,0 +1,116 @@
+#include "multi_tap_delay.h"
+#include <algorithm>
+#include <cmath>
+
+namespace blocks {
+
+namespace {
+
+// Frames written and gathered per pass over the taps
+constexpr size_t kSpan = 256;
+
+size_t lineLength(float maxTime, double sampleRate) {
+    return size_t(std::lround(double(maxTime) * sampleRate)) + 1;
+}
+
+float longestTap(const std::vector<Tap>& taps) {
+    float longest = 0.0f;
+    for (const auto& tap : taps) {
+        longest = std::max(longest, tap.time);
+    }
+    return longest;
+}
+
+} // namespace
+
+MultiTapDelay::MultiTapDelay(std::vector<Tap> taps, float maxTime)
+    : BlockAtomic(1, uint(taps.size()) + 1), taps_(std::move(taps)),
+      tapSamples_(taps_.size(), 0),
+      maxTime_(std::max(maxTime, longestTap(taps_))), line_(0) {
+    for (auto& tap : taps_) {
+        tap.time = std::max(tap.time, 0.0f);
+    }
+    prepare(ProcessSpec{});
+}
+
+void MultiTapDelay::evaluate() {
+    line_.push(inputs_[0]);
+    outputs_[0] = 0.0f;
+    for (uint i = 0; i < taps_.size(); ++i) {
+        outputs_[i + 1] = line_.at(tapSamples_[i]) * taps_[i].gain;
+        outputs_[0] += outputs_[i + 1];
+    }
+}
+
+void MultiTapDelay::evaluateBuffer(InputBuffers_t inputs,
+                                   OutputBuffers_t outputs, uint nFrames) {
+    for (size_t done = 0; done < nFrames; done += kSpan) {
+        size_t n = std::min(kSpan, nFrames - done);
+        // Written before any output, so output 0 may alias the input
+        line_.write(inputs[0] + done, n);
+        float* sum = outputs[0] + done;
+        std::fill_n(sum, n, 0.0f);
+        for (uint i = 0; i < taps_.size(); ++i) {
+            const float* tap = line_.span(tapSamples_[i], n);
+            const float gain = taps_[i].gain;
+            float* single = outputs[i + 1] + done;
+            for (size_t frame = 0; frame < n; ++frame) {
+                single[frame] = tap[frame] * gain;
+                sum[frame] += single[frame];
+            }
+        }
+    }
+}
+
+void MultiTapDelay::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    line_ = ShiftRegister<float>(lineLength(maxTime_, sampleRate_), kSpan,
+                                 spec.allocator);
+    for (uint i = 0; i < taps_.size(); ++i) {
+        tapSamples_[i] = toSamples(taps_[i].time);
+    }
+}
+
+void MultiTapDelay::reset() { line_.clear(); }
+
+size_t MultiTapDelay::getRealtimeMemory(const ProcessSpec& spec) const {
+    size_t length = ShiftRegister<float>::getStorageLength(
+        lineLength(maxTime_, spec.sampleRate), kSpan);
+    return RealtimeAllocator::getChunkSize(length * sizeof(float));
+}
+
+size_t MultiTapDelay::getMemoryUsage() const {
+    return line_.getStorageLength() * sizeof(float);
+}
+
+void MultiTapDelay::setParameter(uint index, float value) {
+    uint tap = index / 2;
+    if (tap >= taps_.size()) {
+        Block::setParameter(index, value);
+    }
+    if (index % 2 == 1) {
+        taps_[tap].gain = value;
+        return;
+    }
+    taps_[tap].time = std::clamp(value, 0.0f, maxTime_);
+    tapSamples_[tap] = toSamples(taps_[tap].time);
+}
+
+uint MultiTapDelay::getTailLength() const {
+    size_t longest = 0;
+    for (size_t samples : tapSamples_) {
+        longest = std::max(longest, samples);
+    }
+    return uint(longest);
+}
+
+std::shared_ptr<Block> MultiTapDelay::clone() const {
+    return std::make_shared<MultiTapDelay>(*this);
+}
+
+size_t MultiTapDelay::toSamples(float time) const {
+    return std::min(size_t(std::lround(double(time) * sampleRate_)),
+                    line_.size() - 1);
+}
+
+} // namespace blocks
@@ -0,0 +1,50 @@
+#ifndef BLOCKS_MULTI_TAP_DELAY_H
+#define BLOCKS_MULTI_TAP_DELAY_H
+
+#include "block.h"
+#include "processes/shift_register.h"
+#include <vector>
+
+namespace blocks {
+
+struct Tap {
+    float time = 0.0f; // seconds
+    float gain = 1.0f;
+};
+
+/*
+Several delays of one signal sharing a single line: each sample is written
+once and every tap reads it back at its own time. Output 0 carries the sum of
+all taps scaled by their gains, output i + 1 tap i alone, also scaled.
+
+Tap times are clamped to maxTime (at least the longest initial tap), for
+which the line is sized in prepare(). Parameter 2 * i sets the time of tap i
+in seconds, parameter 2 * i + 1 its gain.
+*/
+class MultiTapDelay : public BlockAtomic {
+  public:
+    MultiTapDelay(std::vector<Tap> taps, float maxTime = 0.0f);
+    void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    void setParameter(uint index, float value) override;
+    uint getTailLength() const override;
+    std::shared_ptr<Block> clone() const override;
+
+  private:
+    size_t toSamples(float time) const;
+    std::vector<Tap> taps_;
+    std::vector<size_t> tapSamples_;
+    float maxTime_;
+    double sampleRate_ = kDefaultSampleRate;
+    ShiftRegister<float> line_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_MULTI_TAP_DELAY_H
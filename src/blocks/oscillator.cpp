@@ -0,0 +1,188 @@
+#include "oscillator.h"
+#include "exceptions.h"
+#include "processes/fft.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace blocks {
+
+namespace {
+
+// Frames per pass, computed into a local buffer the table cannot alias
+constexpr uint kChunk = 64;
+// Fixed-point phase: the top bits index the table, the rest interpolate
+constexpr uint32_t kIndexShift = 21;
+constexpr uint32_t kFractionMask = (1u << kIndexShift) - 1;
+constexpr float kFractionScale = 1.0f / float(1u << kIndexShift);
+constexpr double kCycle = 4294967296.0;
+constexpr double kPi = 3.14159265358979323846;
+
+static_assert(Wavetable::kTableSize == size_t(1) << (32 - kIndexShift),
+              "The phase must index the whole table");
+
+} // namespace
+
+Wavetable::Wavetable(const std::vector<float>& cycle) {
+    const size_t length = cycle.size();
+    if (length < 4 || (length & (length - 1)) != 0) {
+        throw invalid_operation_error(
+            "Wavetable cycle length must be a power of two, at least 4");
+    }
+    Fft fft(length);
+    std::vector<std::complex<float>> bins(fft.getBinCount());
+    fft.forward(cycle.data(), bins.data());
+    // Rescaled to the table's length; the Nyquist bin is left out
+    std::vector<std::complex<float>> spectrum(kTableSize / 2 + 1);
+    const float scale = float(kTableSize) / float(length);
+    for (size_t k = 0; k < std::min(length / 2, spectrum.size()); ++k) {
+        spectrum[k] = bins[k] * scale;
+    }
+    build(std::move(spectrum));
+}
+
+Wavetable::Wavetable(Waveform waveform) {
+    // Fourier series in sines; a sine of amplitude a is bin -i a N / 2
+    std::vector<std::complex<float>> spectrum(kTableSize / 2 + 1);
+    auto setSine = [&](size_t k, double amplitude) {
+        spectrum[k] = {0.0f, float(-amplitude * kTableSize / 2.0)};
+    };
+    for (size_t k = 1; k <= kMaxHarmonic; ++k) {
+        const bool odd = k % 2 == 1;
+        switch (waveform) {
+        case Waveform::Sine:
+            setSine(k, k == 1 ? 1.0 : 0.0);
+            break;
+        case Waveform::Triangle:
+            // Rising from 0, peaking a quarter cycle in
+            setSine(k, odd ? (k % 4 == 1 ? 8.0 : -8.0) / (kPi * kPi * k * k)
+                           : 0.0);
+            break;
+        case Waveform::Saw:
+            // Rising from -1 to 1
+            setSine(k, -2.0 / (kPi * k));
+            break;
+        case Waveform::Square:
+            // 1 for the first half cycle, -1 for the second
+            setSine(k, odd ? 4.0 / (kPi * k) : 0.0);
+            break;
+        }
+    }
+    build(std::move(spectrum));
+}
+
+void Wavetable::build(std::vector<std::complex<float>> spectrum) {
+    Fft fft(kTableSize);
+    samples_.resize(kLevelCount * (kTableSize + 1));
+    std::vector<std::complex<float>> bins(spectrum.size());
+    for (size_t level = 0; level < kLevelCount; ++level) {
+        const size_t harmonics = kMaxHarmonic >> level;
+        std::fill(bins.begin(), bins.end(), std::complex<float>());
+        std::copy_n(spectrum.cbegin(), harmonics + 1, bins.begin());
+        float* samples = &samples_[level * (kTableSize + 1)];
+        fft.inverse(bins.data(), samples);
+        samples[kTableSize] = samples[0];
+    }
+}
+
+std::shared_ptr<const Wavetable> Wavetable::get(Waveform waveform) {
+    static const std::array<std::shared_ptr<const Wavetable>, 4> tables = {
+        std::shared_ptr<const Wavetable>(new Wavetable(Waveform::Sine)),
+        std::shared_ptr<const Wavetable>(new Wavetable(Waveform::Triangle)),
+        std::shared_ptr<const Wavetable>(new Wavetable(Waveform::Saw)),
+        std::shared_ptr<const Wavetable>(new Wavetable(Waveform::Square))};
+    return tables[size_t(waveform)];
+}
+
+size_t Wavetable::selectLevel(uint32_t increment) {
+    // The highest harmonic must stay below half a cycle per frame
+    for (size_t level = 0; level + 1 < kLevelCount; ++level) {
+        if (uint64_t(kMaxHarmonic >> level) * increment < (uint64_t(1) << 31)) {
+            return level;
+        }
+    }
+    return kLevelCount - 1;
+}
+
+Oscillator::Oscillator(std::shared_ptr<const Wavetable> table,
+                       float frequency, float amplitude, float offset)
+    : BlockAtomic(0, 1), table_(std::move(table)), frequency_(frequency),
+      amplitude_(amplitude), offset_(offset) {
+    prepare(ProcessSpec{});
+}
+
+void Oscillator::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    phase_ = 0;
+    updateIncrement();
+}
+
+void Oscillator::reset() { phase_ = 0; }
+
+void Oscillator::setParameter(uint index, float value) {
+    switch (index) {
+    case 0:
+        frequency_ = value;
+        updateIncrement();
+        break;
+    case 1:
+        amplitude_ = value;
+        break;
+    case 2:
+        offset_ = value;
+        break;
+    case 3:
+        phase_ = uint32_t(int64_t(
+            std::llround((value - std::floor(value)) * kCycle)));
+        break;
+    default:
+        Block::setParameter(index, value);
+    }
+}
+
+void Oscillator::updateIncrement() {
+    double cycles = std::clamp(double(frequency_) / sampleRate_, 0.0, 0.5);
+    increment_ = uint32_t(std::llround(cycles * kCycle));
+}
+
+void Oscillator::evaluate() {
+    float* outputs[] = {outputs_.data()};
+    evaluateBuffer(nullptr, outputs, 1);
+}
+
+void Oscillator::evaluateBuffer(InputBuffers_t /*inputs*/,
+                                OutputBuffers_t outputs, uint nFrames) {
+    // At control rate each run stands for getRateDivisor() frames
+    const uint64_t span = uint64_t(increment_) * getRateDivisor();
+    // Whole cycles drop out of the wrapping phase
+    const uint32_t step = uint32_t(span);
+    const float* table = table_->getLevel(
+        span >= kCycle / 2.0 ? Wavetable::kLevelCount - 1
+                             : Wavetable::selectLevel(step));
+    // Locals, which the output cannot alias
+    const uint32_t phase = phase_;
+    const float amplitude = amplitude_;
+    const float offset = offset_;
+    float chunk[kChunk];
+    for (uint done = 0; done < nFrames; done += kChunk) {
+        const uint n = std::min(kChunk, nFrames - done);
+        const uint32_t start = phase + done * step;
+        for (uint i = 0; i < n; ++i) {
+            uint32_t position = start + i * step;
+            int32_t index = int32_t(position >> kIndexShift);
+            float fraction =
+                float(int32_t(position & kFractionMask)) * kFractionScale;
+            float a = table[index];
+            float b = table[index + 1];
+            chunk[i] = offset + amplitude * (a + fraction * (b - a));
+        }
+        std::copy_n(chunk, n, outputs[0] + done);
+    }
+    phase_ = phase + nFrames * step;
+}
+
+std::shared_ptr<Block> Oscillator::clone() const {
+    return std::make_shared<Oscillator>(*this);
+}
+
+} // namespace blocks
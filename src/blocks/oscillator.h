@@ -0,0 +1,85 @@
+#ifndef BLOCKS_OSCILLATOR_H
+#define BLOCKS_OSCILLATOR_H
+
+#include "block.h"
+#include <complex>
+#include <cstdint>
+
+namespace blocks {
+
+enum class Waveform { Sine, Triangle, Saw, Square };
+
+/*
+One cycle of a waveform, band-limited at a series of levels: level k keeps
+harmonics up to kMaxHarmonic >> k, so every pitch plays from a level
+without harmonics past Nyquist. Levels are kTableSize samples, followed by a
+copy of the first one for interpolation.
+
+Tables are built once and only read afterwards; any number of oscillators,
+on any threads, share one through a shared_ptr.
+*/
+class Wavetable {
+  public:
+    static constexpr size_t kTableSize = 2048;
+    // A quarter of the table, where linear interpolation is still accurate
+    static constexpr size_t kMaxHarmonic = kTableSize / 4;
+    static constexpr size_t kLevelCount = 10;
+
+    // One cycle whose length is a power of two, at least 4
+    explicit Wavetable(const std::vector<float>& cycle);
+    // The shared table of a standard waveform, built on first use
+    static std::shared_ptr<const Wavetable> get(Waveform waveform);
+    // The level to play at a phase increment of increment / 2^32 cycles
+    static size_t selectLevel(uint32_t increment);
+    const float* getLevel(size_t level) const {
+        return &samples_[level * (kTableSize + 1)];
+    }
+    size_t getMemoryUsage() const { return samples_.size() * sizeof(float); }
+
+  private:
+    explicit Wavetable(Waveform waveform);
+    // Fills the levels from the kTableSize / 2 + 1 bins of a full cycle
+    void build(std::vector<std::complex<float>> spectrum);
+    std::vector<float> samples_;
+};
+
+/*
+Source of a periodic signal with no inputs and one output: offset plus
+amplitude times the wavetable, frequency times a second. Phases are 32-bit
+fixed-point numbers of a cycle that wrap around by themselves, so a whole
+buffer of them is one vectorized loop, exact over any run time.
+
+As an LFO, give it an offset and run it at control rate through
+BlockSystem::setRateDivisor(); the phase then advances by the divisor's
+worth of frames each run.
+
+Parameters: 0 frequency in Hz; 1 amplitude; 2 offset; 3 phase, in cycles,
+from which the cycle restarts.
+*/
+class Oscillator : public BlockAtomic {
+  public:
+    Oscillator(std::shared_ptr<const Wavetable> table, float frequency,
+               float amplitude = 1.0f, float offset = 0.0f);
+    void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    void setParameter(uint index, float value) override;
+    std::shared_ptr<Block> clone() const override;
+
+  private:
+    void updateIncrement();
+    std::shared_ptr<const Wavetable> table_;
+    float frequency_;
+    float amplitude_;
+    float offset_;
+    double sampleRate_ = kDefaultSampleRate;
+    uint32_t phase_ = 0;
+    // Per frame at the full rate
+    uint32_t increment_ = 0;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_OSCILLATOR_H
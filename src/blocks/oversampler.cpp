@@ -0,0 +1,281 @@
+#include "oversampler.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <cmath>
+
+namespace blocks {
+
+namespace {
+
+// Frames at the base rate per pass through the wrapped block
+constexpr uint kSpan = 64;
+// The first stage cuts right above the base band; later stages have room
+constexpr size_t kFirstStageTaps = 24;
+constexpr size_t kLaterStageTaps = 8;
+// About 80 dB of stopband attenuation
+constexpr double kKaiserBeta = 8.0;
+constexpr double kPi = 3.14159265358979323846;
+
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; term > 1e-12 * sum; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+uint stageCount(uint factor) {
+    uint stages = 0;
+    while ((1u << stages) < factor) {
+        ++stages;
+    }
+    return stages;
+}
+
+} // namespace
+
+HalfBandFilter::HalfBandFilter(size_t nTaps, size_t maxFrames)
+    : nTaps_(nTaps), taps_(nTaps),
+      upHistory_(nTaps, maxFrames + nTaps - 1),
+      evenHistory_(nTaps, maxFrames + nTaps - 1),
+      oddHistory_(nTaps / 2 + 1, maxFrames + nTaps / 2),
+      even_(maxFrames), odd_(maxFrames) {
+    // Off-centre tap i sits i + 1/2 frames of the low rate from the centre
+    const double half = double(nTaps) / 2.0;
+    double sum = 0.0;
+    for (size_t i = 0; i < nTaps; ++i) {
+        double offset = double(i) - half + 0.5;
+        double sinc = std::sin(kPi * offset) / (kPi * offset);
+        double ratio = offset / half;
+        double window = besselI0(kKaiserBeta * std::sqrt(1.0 - ratio * ratio)) /
+                        besselI0(kKaiserBeta);
+        taps_[i] = float(sinc * window);
+        sum += taps_[i];
+    }
+    // Unity gain at DC for the filtered phase
+    for (float& tap : taps_) {
+        tap = float(tap / sum);
+    }
+}
+
+void HalfBandFilter::upsample(const float* input, float* output, size_t n) {
+    upHistory_.write(input, n);
+    // Oldest first: nTaps_ - 1 frames before the input, then the input
+    const float* window = upHistory_.span(0, n + nTaps_ - 1);
+    const size_t centre = nTaps_ / 2;
+    for (size_t frame = 0; frame < n; ++frame) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < nTaps_; ++k) {
+            sum += taps_[k] * window[frame + k];
+        }
+        output[2 * frame] = sum;
+        output[2 * frame + 1] = window[frame + centre];
+    }
+}
+
+void HalfBandFilter::downsample(const float* input, float* output, size_t n) {
+    for (size_t frame = 0; frame < n; ++frame) {
+        even_[frame] = input[2 * frame];
+        odd_[frame] = input[2 * frame + 1];
+    }
+    evenHistory_.write(even_.data(), n);
+    oddHistory_.write(odd_.data(), n);
+    const float* evens = evenHistory_.span(0, n + nTaps_ - 1);
+    const float* odds = oddHistory_.span(0, n + nTaps_ / 2);
+    for (size_t frame = 0; frame < n; ++frame) {
+        float sum = 0.0f;
+        for (size_t k = 0; k < nTaps_; ++k) {
+            sum += taps_[k] * evens[frame + k];
+        }
+        output[frame] = 0.5f * (sum + odds[frame]);
+    }
+}
+
+void HalfBandFilter::reset() {
+    upHistory_.clear();
+    evenHistory_.clear();
+    oddHistory_.clear();
+}
+
+size_t HalfBandFilter::getMemoryUsage() const {
+    return (taps_.size() + upHistory_.getStorageLength() +
+            evenHistory_.getStorageLength() + oddHistory_.getStorageLength() +
+            even_.size() + odd_.size()) *
+           sizeof(float);
+}
+
+Oversampler::Oversampler(std::shared_ptr<Block> inner, uint factor)
+    : BlockAtomic(inner->getInputSize(), inner->getOutputSize()),
+      inner_(std::move(inner)), factor_(factor) {
+    if (factor_ != 2 && factor_ != 4 && factor_ != 8) {
+        throw invalid_operation_error("Oversampling factor must be 2, 4 or 8");
+    }
+    prepare(ProcessSpec{});
+}
+
+ProcessSpec Oversampler::getInnerSpec(const ProcessSpec& spec) const {
+    ProcessSpec inner = spec;
+    inner.sampleRate = spec.sampleRate * factor_;
+    inner.maxBlockSize = kSpan * factor_;
+    return inner;
+}
+
+void Oversampler::prepare(const ProcessSpec& spec) {
+    inner_->prepare(getInnerSpec(spec));
+    const uint nStages = stageCount(factor_);
+    auto makeStages = [nStages] {
+        std::vector<HalfBandFilter> stages;
+        for (uint s = 0; s < nStages; ++s) {
+            stages.emplace_back(s == 0 ? kFirstStageTaps : kLaterStageTaps,
+                                size_t(kSpan) << s);
+        }
+        return stages;
+    };
+    upsamplers_.clear();
+    downsamplers_.clear();
+    for (uint p = 0; p < getInputSize(); ++p) {
+        upsamplers_.push_back(makeStages());
+    }
+    for (uint p = 0; p < getOutputSize(); ++p) {
+        downsamplers_.push_back(makeStages());
+    }
+    const size_t chunk = size_t(kSpan) * factor_;
+    inputBuffers_.assign(2 * chunk * getInputSize(), 0.0f);
+    outputBuffers_.assign(2 * chunk * getOutputSize(), 0.0f);
+    innerInputs_.assign(getInputSize(), nullptr);
+    innerOutputs_.assign(getOutputSize(), nullptr);
+    frameInputs_.assign(getInputSize(), nullptr);
+    frameOutputs_.assign(getOutputSize(), nullptr);
+    activeStages_ = nStages - std::min(getQualityLevel(), nStages - 1);
+}
+
+void Oversampler::evaluate() {
+    for (uint p = 0; p < getInputSize(); ++p) {
+        frameInputs_[p] = &inputs_[p];
+    }
+    for (uint p = 0; p < getOutputSize(); ++p) {
+        frameOutputs_[p] = &outputs_[p];
+    }
+    evaluateBuffer(frameInputs_.data(), frameOutputs_.data(), 1);
+}
+
+void Oversampler::evaluateBuffer(InputBuffers_t inputs,
+                                 OutputBuffers_t outputs, uint nFrames) {
+    const size_t chunk = size_t(kSpan) * factor_;
+    const uint nStages = activeStages_;
+    for (uint done = 0; done < nFrames; done += kSpan) {
+        const uint n = std::min(kSpan, nFrames - done);
+        for (uint p = 0; p < getInputSize(); ++p) {
+            const float* source = inputs[p] + done;
+            float* buffers = &inputBuffers_[2 * chunk * p];
+            for (uint s = 0; s < nStages; ++s) {
+                float* target = buffers + (s % 2) * chunk;
+                upsamplers_[p][s].upsample(source, target, size_t(n) << s);
+                source = target;
+            }
+            innerInputs_[p] = source;
+        }
+        // Set on every pass, so copies never write into the original
+        for (uint p = 0; p < getOutputSize(); ++p) {
+            innerOutputs_[p] = &outputBuffers_[2 * chunk * p];
+        }
+        inner_->evaluateBuffer(innerInputs_.data(), innerOutputs_.data(),
+                               n << nStages);
+        for (uint p = 0; p < getOutputSize(); ++p) {
+            const float* source = innerOutputs_[p];
+            float* buffers = &outputBuffers_[2 * chunk * p];
+            for (uint s = nStages; s-- > 0;) {
+                float* target = s == 0 ? outputs[p] + done
+                                       : buffers + ((nStages - s) % 2) * chunk;
+                downsamplers_[p][s].downsample(source, target, size_t(n) << s);
+                source = target;
+            }
+        }
+    }
+}
+
+void Oversampler::reset() {
+    inner_->reset();
+    for (auto* ports : {&upsamplers_, &downsamplers_}) {
+        for (auto& stages : *ports) {
+            for (auto& stage : stages) {
+                stage.reset();
+            }
+        }
+    }
+}
+
+size_t Oversampler::getRealtimeMemory(const ProcessSpec& spec) const {
+    return inner_->getRealtimeMemory(getInnerSpec(spec));
+}
+
+size_t Oversampler::getMemoryUsage() const {
+    size_t bytes = inner_->getMemoryUsage() +
+                   (inputBuffers_.size() + outputBuffers_.size()) *
+                       sizeof(float);
+    for (const auto* ports : {&upsamplers_, &downsamplers_}) {
+        for (const auto& stages : *ports) {
+            for (const auto& stage : stages) {
+                bytes += stage.getMemoryUsage();
+            }
+        }
+    }
+    return bytes;
+}
+
+void Oversampler::setParameter(uint index, float value) {
+    inner_->setParameter(index, value);
+}
+
+std::function<void()> Oversampler::prepareParameter(uint index,
+                                                    float value) {
+    return inner_->prepareParameter(index, value);
+}
+
+uint Oversampler::getTailLength() const {
+    uint tail = inner_->getTailLength();
+    if (tail == kInfiniteTail) {
+        return kInfiniteTail;
+    }
+    return (tail + factor_ - 1) / factor_ + uint(std::ceil(getLatency()));
+}
+
+float Oversampler::getCostEstimate() const {
+    return inner_->getCostEstimate() * float(factor_) +
+           0.1f * float(getInputSize() + getOutputSize());
+}
+
+uint Oversampler::getFallbackCount() const { return stageCount(factor_) - 1; }
+
+void Oversampler::onQualityLevel(uint level) {
+    const uint active = stageCount(factor_) - level;
+    // Stages coming back hold what they had when they stopped
+    for (auto* ports : {&upsamplers_, &downsamplers_}) {
+        for (auto& stages : *ports) {
+            for (uint s = activeStages_; s < active; ++s) {
+                stages[s].reset();
+            }
+        }
+    }
+    activeStages_ = active;
+}
+
+float Oversampler::getLatency() const {
+    // Each stage delays by nTaps - 1 frames of its high rate, both ways
+    float latency = inner_->getLatency() / float(1u << activeStages_);
+    for (uint s = 0; s < activeStages_; ++s) {
+        size_t taps = s == 0 ? kFirstStageTaps : kLaterStageTaps;
+        latency += 2.0f * float(taps - 1) / float(2u << s);
+    }
+    return latency;
+}
+
+std::shared_ptr<Block> Oversampler::clone() const {
+    auto copy = std::make_shared<Oversampler>(*this);
+    copy->inner_ = inner_->clone();
+    return copy;
+}
+
+} // namespace blocks
@@ -0,0 +1,99 @@
+#ifndef BLOCKS_OVERSAMPLER_H
+#define BLOCKS_OVERSAMPLER_H
+
+#include "block.h"
+#include "processes/shift_register.h"
+
+namespace blocks {
+
+/*
+Linear-phase half-band lowpass for changing the rate by two, in polyphase
+form: half of a half-band filter's taps are zero and another is the centre
+1/2, so one phase is a plain delay and the other a short FIR, run as a dot
+product per frame. Taps come from a Kaiser-windowed sinc; nTaps, the
+non-zero off-centre taps, trades steepness for cost.
+
+Either direction delays the signal by nTaps - 1 frames at the high rate.
+*/
+class HalfBandFilter {
+  public:
+    HalfBandFilter(size_t nTaps, size_t maxFrames);
+    // n frames to 2 * n, n <= maxFrames
+    void upsample(const float* input, float* output, size_t n);
+    // 2 * n frames to n, n <= maxFrames
+    void downsample(const float* input, float* output, size_t n);
+    void reset();
+    size_t getMemoryUsage() const;
+
+  private:
+    size_t nTaps_;
+    // Off-centre taps reversed, so each output frame is one dot product
+    std::vector<float> taps_;
+    ShiftRegister<float> upHistory_;
+    ShiftRegister<float> evenHistory_;
+    ShiftRegister<float> oddHistory_;
+    std::vector<float> even_;
+    std::vector<float> odd_;
+};
+
+/*
+Runs a block at 2, 4 or 8 times the sample rate, e.g. a nonlinearity that
+would otherwise alias. Each input is upsampled through a cascade of
+half-band stages, the wrapped block runs at the high rate and its outputs
+are filtered back down, so only the wrapped block pays for the higher rate.
+The wrapped block is prepared at factor times the rate and parameters are
+forwarded to it.
+
+The filters add to the latency of the wrapped block, see getLatency().
+
+Under CPU overload each fallback level halves the factor, skipping the
+innermost stages; the wrapped block then runs at a lower rate than it was
+prepared for, which suits memoryless shapers best.
+*/
+class Oversampler : public BlockAtomic {
+  public:
+    Oversampler(std::shared_ptr<Block> inner, uint factor);
+    void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    void setParameter(uint index, float value) override;
+    std::function<void()> prepareParameter(uint index, float value) override;
+    uint getTailLength() const override;
+    float getCostEstimate() const override;
+    std::shared_ptr<Block> clone() const override;
+    uint getFactor() const { return factor_; }
+    // The filters' delay plus that of the wrapped block, at the base rate,
+    // for the stages in use
+    float getLatency() const override;
+
+  protected:
+    uint getFallbackCount() const override;
+    void onQualityLevel(uint level) override;
+
+  private:
+    ProcessSpec getInnerSpec(const ProcessSpec& spec) const;
+    std::shared_ptr<Block> inner_;
+    uint factor_;
+    // Stages in use at the current quality level
+    uint activeStages_ = 0;
+    // Stage s runs between factor 2^s and 2^(s + 1), per input and output
+    std::vector<std::vector<HalfBandFilter>> upsamplers_;
+    std::vector<std::vector<HalfBandFilter>> downsamplers_;
+    // Two chunks at the high rate per port, alternated between stages
+    std::vector<float> inputBuffers_;
+    std::vector<float> outputBuffers_;
+    std::vector<const float*> innerInputs_;
+    std::vector<float*> innerOutputs_;
+    // Single frames of inputs_ and outputs_ for evaluate()
+    std::vector<const float*> frameInputs_;
+    std::vector<float*> frameOutputs_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_OVERSAMPLER_H
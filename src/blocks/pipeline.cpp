@@ -0,0 +1,301 @@
+#include "pipeline.h"
+#include "denormals.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <spdlog/fmt/fmt.h>
+
+namespace blocks {
+
+namespace {
+
+constexpr size_t kPacketsInFlight = 2;
+// Waits spin for this fraction of a buffer's period, and at most kMaxSpin,
+// before sleeping: long enough to catch a neighbour finishing right away,
+// short enough that idle stages leave their cores alone
+constexpr double kSpinFraction = 1.0 / 32.0;
+constexpr std::chrono::microseconds kMaxSpin(50);
+
+// Buffers holding values that are still needed at the start of each step
+std::vector<std::set<uint>> computeLiveIn(const ExecutionPlan& plan) {
+    const uint nSteps = uint(plan.steps.size());
+    std::vector<std::set<uint>> liveIn(nSteps + 1);
+    auto isBuffer = [&plan](uint reference) {
+        return reference != 0 && reference < plan.nBuffers;
+    };
+    liveIn[nSteps].insert(plan.outputBuffers.cbegin(),
+                          plan.outputBuffers.cend());
+    for (const auto& mix : plan.outputMixes) {
+        liveIn[nSteps].erase(mix.target);
+    }
+    for (const auto& mix : plan.outputMixes) {
+        for (const auto& [reference, gain] : mix.sources) {
+            if (isBuffer(reference)) {
+                liveIn[nSteps].insert(reference);
+            }
+        }
+    }
+    liveIn[nSteps].erase(0);
+    for (uint i = nSteps; i-- > 0;) {
+        const auto& step = plan.steps[i];
+        std::set<uint> live = liveIn[i + 1];
+        for (uint buffer : step.outputs) {
+            live.erase(buffer);
+        }
+        for (uint reference : step.inputs) {
+            if (isBuffer(reference)) {
+                live.insert(reference);
+            }
+        }
+        for (const auto& mix : step.mixes) {
+            live.erase(mix.target);
+        }
+        for (const auto& mix : step.mixes) {
+            for (const auto& [reference, gain] : mix.sources) {
+                if (isBuffer(reference)) {
+                    live.insert(reference);
+                }
+            }
+        }
+        liveIn[i] = std::move(live);
+    }
+    liveIn[0].erase(0);
+    return liveIn;
+}
+
+// cuttable[c] is false when a feedback loop spans the boundary before step c
+std::vector<bool> findCuttableBoundaries(const ExecutionPlan& plan) {
+    const uint nSteps = uint(plan.steps.size());
+    std::vector<uint> firstUse(plan.nCells, nSteps);
+    std::vector<uint> lastUse(plan.nCells, 0);
+    auto touch = [&](uint reference, uint step) {
+        if (reference >= plan.nBuffers) {
+            uint cell = reference - plan.nBuffers;
+            firstUse[cell] = std::min(firstUse[cell], step);
+            lastUse[cell] = std::max(lastUse[cell], step);
+        }
+    };
+    for (uint i = 0; i < nSteps; ++i) {
+        const auto& step = plan.steps[i];
+        for (uint reference : step.inputs) {
+            touch(reference, i);
+        }
+        for (const auto& mix : step.mixes) {
+            for (const auto& [reference, gain] : mix.sources) {
+                touch(reference, i);
+            }
+        }
+        for (const auto& [buffer, cell] : step.feedbackStores) {
+            touch(plan.nBuffers + cell, i);
+        }
+    }
+    std::vector<bool> cuttable(nSteps + 1, true);
+    for (uint cell = 0; cell < plan.nCells; ++cell) {
+        for (uint c = firstUse[cell] + 1; c <= lastUse[cell]; ++c) {
+            cuttable[c] = false;
+        }
+    }
+    return cuttable;
+}
+
+std::vector<uint> chooseCuts(const ExecutionPlan& plan, const Blocks_t& blocks,
+                             uint nStages) {
+    const uint nSteps = uint(plan.steps.size());
+    std::vector<float> prefix(nSteps + 1, 0.0f);
+    for (uint i = 0; i < nSteps; ++i) {
+        const auto& block = blocks[plan.steps[i].block];
+        prefix[i + 1] = prefix[i] + block->getCostEstimate() /
+                                        float(block->getRateDivisor());
+    }
+    auto cuttable = findCuttableBoundaries(plan);
+    std::vector<uint> cuts{0};
+    for (uint k = 1; k < nStages; ++k) {
+        float target = prefix[nSteps] * float(k) / float(nStages);
+        uint best = 0;
+        for (uint c = cuts.back() + 1; c < nSteps; ++c) {
+            if (cuttable[c] &&
+                (best == 0 || std::fabs(prefix[c] - target) <
+                                  std::fabs(prefix[best] - target))) {
+                best = c;
+            }
+        }
+        if (best == 0) {
+            break;
+        }
+        cuts.emplace_back(best);
+    }
+    cuts.emplace_back(nSteps);
+    return cuts;
+}
+
+} // namespace
+
+Pipeline::Pipeline(std::shared_ptr<BlockSystem> system, uint nStages,
+                   uint maxFrames)
+    : system_(system), plan_(system->getExecutionPlan()),
+      blocks_(system->viewBlocks()), maxFrames_(std::max(maxFrames, 1u)) {
+    if (nStages == 0) {
+        throw invalid_operation_error("Pipeline needs at least one stage");
+    }
+    auto cuts = chooseCuts(*plan_, blocks_, nStages);
+    auto liveIn = computeLiveIn(*plan_);
+    for (uint i = 0; i + 1 < cuts.size(); ++i) {
+        auto stage = std::make_unique<Stage>();
+        stage->firstStep = cuts[i];
+        stage->lastStep = cuts[i + 1];
+        if (i == 0) {
+            stage->received = plan_->inputBuffers;
+        } else {
+            stage->received.assign(liveIn[cuts[i]].cbegin(),
+                                   liveIn[cuts[i]].cend());
+        }
+        if (i + 2 == cuts.size()) {
+            stage->sent = plan_->outputBuffers;
+        } else {
+            stage->sent.assign(liveIn[cuts[i + 1]].cbegin(),
+                               liveIn[cuts[i + 1]].cend());
+        }
+        preparePlanState(*plan_, blocks_, stage->state, maxFrames_);
+        Packet prototype;
+        prototype.samples.assign(stage->sent.size() * maxFrames_, 0.0f);
+        stage->output = std::make_unique<SpscRing<Packet>>(kPacketsInFlight,
+                                                           prototype);
+        stages_.emplace_back(std::move(stage));
+    }
+    const double period = double(maxFrames_) /
+                          std::max(system_->getProcessSpec().sampleRate, 1.0);
+    spinWindow_ = std::min<std::chrono::nanoseconds>(
+        std::chrono::nanoseconds(int64_t(period * kSpinFraction * 1e9)),
+        kMaxSpin);
+    for (uint i = 1; i < stages_.size(); ++i) {
+        stages_[i]->thread = std::thread(&Pipeline::workerLoop, this, i);
+    }
+}
+
+Pipeline::~Pipeline() {
+    stop_ = true;
+    for (auto& stage : stages_) {
+        notify(stage->filled);
+        notify(stage->drained);
+    }
+    for (auto& stage : stages_) {
+        if (stage->thread.joinable()) {
+            stage->thread.join();
+        }
+    }
+}
+
+template <typename Ready> void Pipeline::await(Signal& signal, Ready ready) {
+    if (ready()) {
+        return;
+    }
+    const auto spinEnd = std::chrono::steady_clock::now() + spinWindow_;
+    while (std::chrono::steady_clock::now() < spinEnd) {
+        if (ready()) {
+            return;
+        }
+    }
+    std::unique_lock<std::mutex> lock(signal.mutex);
+    signal.sleepers.fetch_add(1);
+    // Pairs with the fence in notify(): either the waker sees the sleeper,
+    // or ready() sees what the waker published
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    signal.wake.wait(lock, ready);
+    signal.sleepers.fetch_sub(1);
+}
+
+void Pipeline::notify(Signal& signal) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (signal.sleepers.load(std::memory_order_relaxed) > 0) {
+        // Taking the lock orders this after the sleeper's last check
+        std::lock_guard<std::mutex> lock(signal.mutex);
+        signal.wake.notify_one();
+    }
+}
+
+void Pipeline::process(InputBuffers_t inputs, OutputBuffers_t outputs,
+                       uint nFrames) {
+    if (nFrames > maxFrames_ || (nFrames_ != 0 && nFrames != nFrames_)) {
+        throw invalid_operation_error(fmt::format(
+            "Pipeline expects a constant buffer of at most {} frames",
+            maxFrames_));
+    }
+    nFrames_ = nFrames;
+    ScopedFlushDenormals flushDenormals;
+    Stage& first = *stages_.front();
+    for (uint i = 0; i < first.received.size(); ++i) {
+        std::copy_n(inputs[i], nFrames,
+                    bufferData(first.state, first.received[i]));
+        updateSilence(first.state, first.received[i], nFrames);
+    }
+    runStage(first, nFrames);
+    if (pendingOutputs_ < getLatency()) {
+        ++pendingOutputs_;
+        for (uint i = 0; i < plan_->outputBuffers.size(); ++i) {
+            std::fill_n(outputs[i], nFrames, 0.0f);
+        }
+        return;
+    }
+    Stage& last = *stages_.back();
+    auto& results = *last.output;
+    Packet* packet = nullptr;
+    await(last.filled, [&] {
+        packet = results.beginRead();
+        return packet != nullptr;
+    });
+    for (uint i = 0; i < plan_->outputBuffers.size(); ++i) {
+        std::copy_n(packet->samples.data() + size_t(i) * maxFrames_,
+                    packet->nFrames, outputs[i]);
+    }
+    results.endRead();
+    notify(last.drained);
+}
+
+void Pipeline::runStage(Stage& stage, uint nFrames) {
+    runPlanSteps(*plan_, blocks_, stage.state, stage.firstStep,
+                 stage.lastStep, nFrames);
+    Packet* packet = nullptr;
+    await(stage.drained, [&] {
+        packet = stage.output->beginWrite();
+        return packet != nullptr || stop_;
+    });
+    if (packet == nullptr) {
+        return;
+    }
+    packet->nFrames = nFrames;
+    for (uint i = 0; i < stage.sent.size(); ++i) {
+        std::copy_n(bufferData(stage.state, stage.sent[i]), nFrames,
+                    packet->samples.data() + size_t(i) * maxFrames_);
+    }
+    stage.output->endWrite();
+    notify(stage.filled);
+}
+
+void Pipeline::workerLoop(uint stageIdx) {
+    ScopedFlushDenormals flushDenormals;
+    Stage& stage = *stages_[stageIdx];
+    Stage& previous = *stages_[stageIdx - 1];
+    auto& input = *previous.output;
+    while (true) {
+        Packet* packet = nullptr;
+        await(previous.filled, [&] {
+            packet = input.beginRead();
+            return packet != nullptr || stop_;
+        });
+        if (stop_) {
+            return;
+        }
+        uint nFrames = packet->nFrames;
+        for (uint i = 0; i < stage.received.size(); ++i) {
+            std::copy_n(packet->samples.data() + size_t(i) * maxFrames_,
+                        nFrames, bufferData(stage.state, stage.received[i]));
+            updateSilence(stage.state, stage.received[i], nFrames);
+        }
+        input.endRead();
+        notify(previous.drained);
+        runStage(stage, nFrames);
+    }
+}
+
+} // namespace blocks
@@ -0,0 +1,85 @@
+#ifndef BLOCKS_PIPELINE_H
+#define BLOCKS_PIPELINE_H
+
+#include "block_system.h"
+#include "execution_plan.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace blocks {
+
+/*
+Runs a block system as a chain of stages, each on its own thread. The
+evaluation sequence is cut into stages of similar estimated cost, never inside
+a feedback loop. While stage k processes buffer t, stage k + 1 processes
+buffer t - 1, so outputs lag the inputs by getLatency() buffers, i.e.
+(stages - 1) * nFrames samples. The first getLatency() calls output silence.
+
+A stage that finds nothing to do spins for a small fraction of a buffer's
+period, then sleeps until its neighbour hands over a packet or frees a slot,
+so idle stages cost no CPU. process() waits the same way for the last stage.
+
+Every call to process() must use the same nFrames. The wrapped system must not
+be edited or evaluated directly while the pipeline exists.
+*/
+class Pipeline {
+  public:
+    Pipeline(std::shared_ptr<BlockSystem> system, uint nStages,
+             uint maxFrames);
+    ~Pipeline();
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    void process(InputBuffers_t inputs, OutputBuffers_t outputs,
+                 uint nFrames);
+    uint getStageCount() const { return uint(stages_.size()); }
+    uint getLatency() const { return getStageCount() - 1; }
+
+  private:
+    // Where threads sleep until a ring's state changes; sleepers counts
+    // them, so handing over a packet only takes the lock when one is asleep
+    struct Signal {
+        std::atomic<uint> sleepers{0};
+        std::mutex mutex;
+        std::condition_variable wake;
+    };
+    struct Packet {
+        uint nFrames = 0;
+        std::vector<float> samples;
+    };
+    struct Stage {
+        uint firstStep = 0;
+        uint lastStep = 0;
+        std::vector<uint> received;
+        std::vector<uint> sent;
+        PlanState state;
+        std::unique_ptr<SpscRing<Packet>> output;
+        // A packet was written to, or read from, output
+        Signal filled;
+        Signal drained;
+        std::thread thread;
+    };
+    // Returns once ready() is true, spinning for at most spinWindow_ first
+    template <typename Ready> void await(Signal& signal, Ready ready);
+    static void notify(Signal& signal);
+    void runStage(Stage& stage, uint nFrames);
+    void workerLoop(uint stageIdx);
+    std::shared_ptr<BlockSystem> system_;
+    std::shared_ptr<const ExecutionPlan> plan_;
+    Blocks_t blocks_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::atomic<bool> stop_{false};
+    std::chrono::nanoseconds spinWindow_{0};
+    uint maxFrames_ = 0;
+    uint pendingOutputs_ = 0;
+    uint nFrames_ = 0;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_PIPELINE_H
@@ -1,4 +1,5 @@
 #include "process_block.h"
+#include <algorithm>
 
 namespace blocks {
 
@@ -10,4 +11,59 @@ void ProcessBlock::evaluate() {
     outputs_[0] = process_->process(sample);
 }
 
+void ProcessBlock::prepare(const ProcessSpec& spec) {
+    process_->prepare(spec);
+}
+
+void ProcessBlock::reset() { process_->reset(); }
+
+void ProcessBlock::evaluateBuffer(InputBuffers_t inputs,
+                                  OutputBuffers_t outputs, uint nFrames) {
+    process_->processBuffer(inputs[0], outputs[0], nFrames);
+}
+
+bool ProcessBlock::canProcessInPlace() const {
+    return process_->canProcessInPlace();
+}
+
+void ProcessBlock::setParameter(uint index, float value) {
+    process_->setParameter(index, value);
+}
+
+uint ProcessBlock::getTailLength() const {
+    return uint(std::min<size_t>(process_->getTailLength(), kInfiniteTail));
+}
+
+std::function<void()> ProcessBlock::prepareParameter(uint index,
+                                                     float value) {
+    return process_->prepareParameter(index, value);
+}
+
+size_t ProcessBlock::getRealtimeMemory(const ProcessSpec& spec) const {
+    return process_->getRealtimeMemory(spec);
+}
+
+size_t ProcessBlock::getMemoryUsage() const {
+    return process_->getMemoryUsage();
+}
+
+uint ProcessBlock::getFallbackCount() const {
+    return process_->getFallbackCount();
+}
+
+void ProcessBlock::onQualityLevel(uint level) {
+    process_->setQualityLevel(level);
+}
+
+std::shared_ptr<Block> ProcessBlock::clone() const {
+    auto block = std::make_shared<ProcessBlock>(process_->clone());
+    block->setName(std::string(getName()));
+    block->setRateDivisor(getRateDivisor());
+    block->setBypassed(isBypassed());
+    block->setNonFiniteGuard(hasNonFiniteGuard());
+    block->setBypassUnderLoad(isBypassableUnderLoad());
+    block->setQualityLevel(getQualityLevel());
+    return block;
+}
+
 } // namespace blocks
@@ -10,6 +10,21 @@ class ProcessBlock : public BlockAtomic {
   public:
     ProcessBlock(std::unique_ptr<Process> process);
     void evaluate() override;
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override;
+    void setParameter(uint index, float value) override;
+    std::function<void()> prepareParameter(uint index, float value) override;
+    uint getTailLength() const override;
+    std::shared_ptr<Block> clone() const override;
+
+  protected:
+    uint getFallbackCount() const override;
+    void onQualityLevel(uint level) override;
 
   private:
     std::unique_ptr<Process> process_;
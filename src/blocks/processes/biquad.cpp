@@ -0,0 +1,243 @@
+#include "biquad.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace blocks {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+} // namespace
+
+BiquadCoefficients BiquadCoefficients::design(const FilterBand& band,
+                                              double sampleRate) {
+    double frequency =
+        std::clamp(double(band.frequency), 1.0, 0.49 * sampleRate);
+    double q = std::max(double(band.q), 1e-3);
+    double w0 = 2.0 * kPi * frequency / sampleRate;
+    double cosw = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double A = std::pow(10.0, double(band.gainDb) / 40.0);
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+    switch (band.type) {
+    case FilterType::LowPass:
+        b0 = b2 = (1.0 - cosw) / 2.0;
+        b1 = 1.0 - cosw;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosw;
+        a2 = 1.0 - alpha;
+        break;
+    case FilterType::HighPass:
+        b0 = b2 = (1.0 + cosw) / 2.0;
+        b1 = -(1.0 + cosw);
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosw;
+        a2 = 1.0 - alpha;
+        break;
+    case FilterType::Peak:
+        b0 = 1.0 + alpha * A;
+        b1 = -2.0 * cosw;
+        b2 = 1.0 - alpha * A;
+        a0 = 1.0 + alpha / A;
+        a1 = -2.0 * cosw;
+        a2 = 1.0 - alpha / A;
+        break;
+    case FilterType::LowShelf: {
+        double root = 2.0 * std::sqrt(A) * alpha;
+        b0 = A * ((A + 1.0) - (A - 1.0) * cosw + root);
+        b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw);
+        b2 = A * ((A + 1.0) - (A - 1.0) * cosw - root);
+        a0 = (A + 1.0) + (A - 1.0) * cosw + root;
+        a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cosw);
+        a2 = (A + 1.0) + (A - 1.0) * cosw - root;
+        break;
+    }
+    case FilterType::HighShelf: {
+        double root = 2.0 * std::sqrt(A) * alpha;
+        b0 = A * ((A + 1.0) + (A - 1.0) * cosw + root);
+        b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw);
+        b2 = A * ((A + 1.0) + (A - 1.0) * cosw - root);
+        a0 = (A + 1.0) - (A - 1.0) * cosw + root;
+        a1 = 2.0 * ((A - 1.0) - (A + 1.0) * cosw);
+        a2 = (A + 1.0) - (A - 1.0) * cosw - root;
+        break;
+    }
+    }
+    return {float(b0 / a0), float(b1 / a0), float(b2 / a0), float(a1 / a0),
+            float(a2 / a0)};
+}
+
+size_t BiquadCoefficients::getDecayLength() const {
+    // Largest pole magnitude of z^2 + a1 z + a2
+    double discriminant = double(a1) * a1 - 4.0 * double(a2);
+    double radius = 0.0;
+    if (discriminant < 0.0) {
+        radius = std::sqrt(double(a2));
+    } else {
+        double root = std::sqrt(discriminant);
+        radius = std::max(std::fabs(-a1 + root), std::fabs(-a1 - root)) / 2.0;
+    }
+    if (radius >= 1.0) {
+        return SIZE_MAX;
+    }
+    if (radius <= 0.0) {
+        return 2;
+    }
+    // -120 dB, plus the two frames of the feed-forward part
+    return size_t(std::ceil(std::log(1e-6) / std::log(radius))) + 2;
+}
+
+BiquadLanes::BiquadLanes(size_t nLanes)
+    : b0_(nLanes, 1.0f), b1_(nLanes, 0.0f), b2_(nLanes, 0.0f),
+      a1_(nLanes, 0.0f), a2_(nLanes, 0.0f), s1_(nLanes, 0.0f),
+      s2_(nLanes, 0.0f), targets_(nLanes), increments_(nLanes) {}
+
+void BiquadLanes::setTarget(size_t lane,
+                            const BiquadCoefficients& coefficients) {
+    targets_[lane] = coefficients;
+    // Every lane restarts its ramp from where it stands
+    const float frames = float(kSmoothingFrames);
+    for (size_t i = 0; i < size(); ++i) {
+        increments_[i] = {(targets_[i].b0 - b0_[i]) / frames,
+                          (targets_[i].b1 - b1_[i]) / frames,
+                          (targets_[i].b2 - b2_[i]) / frames,
+                          (targets_[i].a1 - a1_[i]) / frames,
+                          (targets_[i].a2 - a2_[i]) / frames};
+    }
+    rampRemaining_ = kSmoothingFrames;
+}
+
+void BiquadLanes::snap() {
+    for (size_t i = 0; i < size(); ++i) {
+        b0_[i] = targets_[i].b0;
+        b1_[i] = targets_[i].b1;
+        b2_[i] = targets_[i].b2;
+        a1_[i] = targets_[i].a1;
+        a2_[i] = targets_[i].a2;
+    }
+    rampRemaining_ = 0;
+}
+
+void BiquadLanes::reset() {
+    std::fill(s1_.begin(), s1_.end(), 0.0f);
+    std::fill(s2_.begin(), s2_.end(), 0.0f);
+}
+
+void BiquadLanes::step() {
+    if (--rampRemaining_ == 0) {
+        // Land exactly on the target rather than on accumulated increments
+        snap();
+        return;
+    }
+    for (size_t i = 0; i < size(); ++i) {
+        b0_[i] += increments_[i].b0;
+        b1_[i] += increments_[i].b1;
+        b2_[i] += increments_[i].b2;
+        a1_[i] += increments_[i].a1;
+        a2_[i] += increments_[i].a2;
+    }
+}
+
+bool setBandParameter(std::vector<FilterBand>& bands, unsigned index,
+                      float value) {
+    if (index / 3 >= bands.size()) {
+        return false;
+    }
+    FilterBand& band = bands[index / 3];
+    switch (index % 3) {
+    case 0:
+        band.frequency = value;
+        break;
+    case 1:
+        band.q = value;
+        break;
+    default:
+        band.gainDb = value;
+        break;
+    }
+    return true;
+}
+
+Biquad::Biquad(std::vector<FilterBand> bands)
+    : bands_(std::move(bands)), sections_(bands_.size()),
+      stage_(bands_.size()), staged_(bands_.size()) {
+    prepare(ProcessSpec{});
+}
+
+float Biquad::process(float x) {
+    sections_.advance();
+    for (size_t k = 0; k < bands_.size(); ++k) {
+        sections_.process(&x, &x, k, 1);
+    }
+    return x;
+}
+
+std::unique_ptr<Process> Biquad::clone() const {
+    return std::make_unique<Biquad>(*this);
+}
+
+void Biquad::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    for (size_t k = 0; k < bands_.size(); ++k) {
+        sections_.setTarget(k,
+                            BiquadCoefficients::design(bands_[k], sampleRate_));
+    }
+    sections_.snap();
+    reset();
+}
+
+void Biquad::reset() {
+    sections_.reset();
+    std::fill(staged_.begin(), staged_.end(), 0.0f);
+}
+
+void Biquad::processBuffer(const float* input, float* output,
+                           size_t nFrames) {
+    const size_t nSections = bands_.size();
+    if (nSections == 0) {
+        std::copy_n(input, nFrames, output);
+        return;
+    }
+    // Step t feeds frame t to section 0 and frame t - k to section k; the
+    // first and last nSections - 1 steps only run the sections with a frame
+    for (size_t t = 0; t < nFrames + nSections - 1; ++t) {
+        size_t first = t >= nFrames ? t - nFrames + 1 : 0;
+        size_t last = std::min(nSections, t + 1);
+        std::copy(staged_.begin() + std::max<size_t>(first, 1) - 1,
+                  staged_.begin() + last - 1,
+                  stage_.begin() + std::max<size_t>(first, 1));
+        if (t < nFrames) {
+            stage_[0] = input[t];
+            sections_.advance();
+        }
+        sections_.process(stage_.data() + first, staged_.data() + first,
+                          first, last - first);
+        if (t + 1 >= nSections) {
+            output[t + 1 - nSections] = staged_[nSections - 1];
+        }
+    }
+}
+
+size_t Biquad::getTailLength() const {
+    size_t tail = 0;
+    for (size_t k = 0; k < bands_.size(); ++k) {
+        size_t decay = sections_.getTarget(k).getDecayLength();
+        if (decay == SIZE_MAX) {
+            return SIZE_MAX;
+        }
+        tail += decay;
+    }
+    return tail;
+}
+
+void Biquad::setParameter(unsigned index, float value) {
+    if (!setBandParameter(bands_, index, value)) {
+        Process::setParameter(index, value);
+    }
+    sections_.setTarget(
+        index / 3, BiquadCoefficients::design(bands_[index / 3], sampleRate_));
+}
+
+} // namespace blocks
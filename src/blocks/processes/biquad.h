@@ -0,0 +1,123 @@
+#ifndef BLOCKS_PROCESSES_BIQUAD_H
+#define BLOCKS_PROCESSES_BIQUAD_H
+
+#include "process.h"
+#include <vector>
+
+namespace blocks {
+
+enum class FilterType { LowPass, HighPass, Peak, LowShelf, HighShelf };
+
+/*
+One second-order section of an equalizer. Frequency is the cutoff, centre or
+shelf midpoint in Hz, clamped below Nyquist; gainDb only affects peaks and
+shelves.
+*/
+struct FilterBand {
+    FilterType type = FilterType::Peak;
+    float frequency = 1000.0f;
+    float q = 0.70710678f;
+    float gainDb = 0.0f;
+};
+
+// Normalized biquad coefficients, a0 == 1
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+
+    // Audio EQ Cookbook (R. Bristow-Johnson) design for the given band
+    static BiquadCoefficients design(const FilterBand& band,
+                                     double sampleRate);
+    // Frames for the impulse response to decay by 120 dB
+    size_t getDecayLength() const;
+};
+
+/*
+Independent biquads in transposed direct form II, stored as structure of
+arrays so one frame through many lanes is a loop the compiler vectorizes.
+What a lane is – a channel, a cascade section or both – is up to the owner.
+
+New coefficients are approached in a linear ramp over kSmoothingFrames,
+advanced by advance() once per frame, so sweeping a band does not click.
+*/
+class BiquadLanes {
+  public:
+    static constexpr unsigned kSmoothingFrames = 256;
+
+    explicit BiquadLanes(size_t nLanes = 0);
+    size_t size() const { return b0_.size(); }
+    // Ramps lane towards the given coefficients
+    void setTarget(size_t lane, const BiquadCoefficients& coefficients);
+    // Jumps every lane to its target
+    void snap();
+    void reset();
+    // One step of the coefficient ramp
+    void advance() {
+        if (rampRemaining_ > 0) {
+            step();
+        }
+    }
+    // One frame through lanes [first, first + count); x and y may alias
+    void process(const float* x, float* y, size_t first, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t lane = first + i;
+            float in = x[i];
+            float out = b0_[lane] * in + s1_[lane];
+            s1_[lane] = b1_[lane] * in - a1_[lane] * out + s2_[lane];
+            s2_[lane] = b2_[lane] * in - a2_[lane] * out;
+            y[i] = out;
+        }
+    }
+    const BiquadCoefficients& getTarget(size_t lane) const {
+        return targets_[lane];
+    }
+
+  private:
+    void step();
+    std::vector<float> b0_, b1_, b2_, a1_, a2_;
+    std::vector<float> s1_, s2_;
+    std::vector<BiquadCoefficients> targets_;
+    std::vector<BiquadCoefficients> increments_;
+    unsigned rampRemaining_ = 0;
+};
+
+/*
+A cascade of biquads, e.g. a parametric equalizer. Parameter 3 * i sets the
+frequency of band i in Hz, 3 * i + 1 its Q and 3 * i + 2 its gain in dB.
+
+Buffers run the sections as lanes of a pipeline: at each step section k
+filters the frame section k - 1 produced one step earlier, so all sections
+advance together in one vectorized pass without adding latency.
+*/
+class Biquad : public Process {
+  public:
+    explicit Biquad(std::vector<FilterBand> bands);
+    float process(float x) override;
+    std::unique_ptr<Process> clone() const override;
+    void prepare(const ProcessSpec& spec) override;
+    void reset() override;
+    void processBuffer(const float* input, float* output,
+                       size_t nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    size_t getTailLength() const override;
+    void setParameter(unsigned index, float value) override;
+
+  private:
+    std::vector<FilterBand> bands_;
+    double sampleRate_ = kDefaultSampleRate;
+    BiquadLanes sections_;
+    // Per section input and output of the current pipeline step
+    std::vector<float> stage_;
+    std::vector<float> staged_;
+};
+
+// Applies parameter index (see Biquad) to bands; false if out of range
+bool setBandParameter(std::vector<FilterBand>& bands, unsigned index,
+                      float value);
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_BIQUAD_H
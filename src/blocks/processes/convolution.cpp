@@ -0,0 +1,440 @@
+#include "convolution.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace blocks {
+
+namespace {
+
+// Where the tail starts: its blocks get a whole block to be computed in
+constexpr size_t kTailStart = 2 * Convolution::kTailBlock;
+
+} // namespace
+
+/*
+The thread computing the tails of every background convolution, so that
+any number of convolutions, clones included, cost one thread. Convolutions
+join in their constructor and leave in their destructor; in between, the
+worker runs whatever jobs they have submitted, one convolution at a time.
+*/
+class TailWorker {
+  public:
+    // The shared worker, started for its first user
+    static std::shared_ptr<TailWorker> get();
+    TailWorker() : thread_(&TailWorker::loop, this) {}
+    ~TailWorker();
+    TailWorker(const TailWorker&) = delete;
+    TailWorker& operator=(const TailWorker&) = delete;
+    void add(Convolution* client);
+    // Returns once the worker no longer runs client's jobs
+    void remove(Convolution* client);
+    // Never blocks; false if the wakeup may have come too early, see
+    // Convolution::wakeWorker()
+    bool wake();
+    void waitUntilComputed(const Convolution& client);
+
+  private:
+    void loop();
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<Convolution*> clients_;
+    // Whose jobs run while mutex_ is released
+    Convolution* running_ = nullptr;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+std::shared_ptr<TailWorker> TailWorker::get() {
+    static std::mutex mutex;
+    static std::weak_ptr<TailWorker> shared;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto worker = shared.lock();
+    if (worker == nullptr) {
+        worker = std::make_shared<TailWorker>();
+        shared = worker;
+    }
+    return worker;
+}
+
+TailWorker::~TailWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void TailWorker::add(Convolution* client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clients_.emplace_back(client);
+}
+
+void TailWorker::remove(Convolution* client) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this, client] { return running_ != client; });
+    clients_.erase(std::find(clients_.begin(), clients_.end(), client));
+}
+
+bool TailWorker::wake() {
+    bool locked = mutex_.try_lock();
+    if (locked) {
+        mutex_.unlock();
+    }
+    wake_.notify_one();
+    return locked;
+}
+
+void TailWorker::waitUntilComputed(const Convolution& client) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // In case the last wakeup was missed
+    wake_.notify_one();
+    idle_.wait(lock, [&client] { return !client.hasTailJobs(); });
+}
+
+void TailWorker::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto hasJobs = [this] {
+        return std::any_of(clients_.cbegin(), clients_.cend(),
+                           [](const Convolution* client) {
+                               return client->hasTailJobs();
+                           });
+    };
+    while (true) {
+        wake_.wait(lock, [&] { return stop_ || hasJobs(); });
+        if (stop_) {
+            return;
+        }
+        // Clients may come and go while the lock is released; one that is
+        // skipped meanwhile is found by the next round
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            running_ = clients_[i];
+            lock.unlock();
+            running_->runTailJobs();
+            lock.lock();
+            running_ = nullptr;
+            idle_.notify_all();
+        }
+    }
+}
+
+UniformConvolver::UniformConvolver(const float* taps, size_t nTaps,
+                                   size_t blockSize)
+    : blockSize_(blockSize),
+      nPartitions_(std::max<size_t>((nTaps + blockSize - 1) / blockSize, 1)),
+      fft_(2 * blockSize),
+      partitions_(nPartitions_ * fft_.getBinCount()),
+      spectra_(nPartitions_ * fft_.getBinCount()), window_(2 * blockSize),
+      accumulator_(fft_.getBinCount()), result_(2 * blockSize) {
+    std::vector<float> padded(2 * blockSize);
+    for (size_t p = 0; p < nPartitions_; ++p) {
+        std::fill(padded.begin(), padded.end(), 0.0f);
+        size_t first = p * blockSize;
+        size_t count = std::min(blockSize, nTaps - std::min(nTaps, first));
+        std::copy_n(taps + first, count, padded.begin());
+        fft_.forward(padded.data(), &partitions_[p * fft_.getBinCount()]);
+    }
+}
+
+void UniformConvolver::process(const float* input, float* output) {
+    const size_t nBins = fft_.getBinCount();
+    std::copy(window_.begin() + blockSize_, window_.end(), window_.begin());
+    std::copy_n(input, blockSize_, window_.begin() + blockSize_);
+    newest_ = newest_ == 0 ? nPartitions_ - 1 : newest_ - 1;
+    fft_.forward(window_.data(), &spectra_[newest_ * nBins]);
+
+    // Partition p meets the window from p blocks ago
+    std::fill(accumulator_.begin(), accumulator_.end(), 0.0f);
+    for (size_t p = 0; p < nPartitions_; ++p) {
+        size_t age = (newest_ + p) % nPartitions_;
+        const auto* x = reinterpret_cast<const float*>(&spectra_[age * nBins]);
+        const auto* h =
+            reinterpret_cast<const float*>(&partitions_[p * nBins]);
+        auto* sum = reinterpret_cast<float*>(accumulator_.data());
+        for (size_t bin = 0; bin < 2 * nBins; bin += 2) {
+            sum[bin] += x[bin] * h[bin] - x[bin + 1] * h[bin + 1];
+            sum[bin + 1] += x[bin] * h[bin + 1] + x[bin + 1] * h[bin];
+        }
+    }
+    fft_.inverse(accumulator_.data(), result_.data());
+    // The first half wrapped around; the second is the linear convolution
+    std::copy_n(result_.begin() + blockSize_, blockSize_, output);
+}
+
+void UniformConvolver::reset() {
+    std::fill(spectra_.begin(), spectra_.end(), 0.0f);
+    std::fill(window_.begin(), window_.end(), 0.0f);
+    newest_ = 0;
+}
+
+size_t UniformConvolver::getMemoryUsage() const {
+    return (partitions_.size() + spectra_.size() + accumulator_.size()) *
+               sizeof(std::complex<float>) +
+           (window_.size() + result_.size()) * sizeof(float);
+}
+
+Convolution::Convolution(std::vector<float> impulseResponse,
+                         bool backgroundTail)
+    : impulseResponse_(std::move(impulseResponse)),
+      backgroundTail_(backgroundTail), head_(kHeadLength, 0.0f),
+      history_(kHeadLength, 2 * kHeadLength) {
+    const size_t length = impulseResponse_.size();
+    const float* taps = impulseResponse_.data();
+    for (size_t k = 0; k < std::min(length, kHeadLength); ++k) {
+        head_[kHeadLength - 1 - k] = taps[k];
+    }
+    if (length > kHeadLength) {
+        body_ = std::make_unique<UniformConvolver>(
+            taps + kHeadLength, std::min(length, kTailStart) - kHeadLength,
+            kHeadLength);
+        bodyInput_.resize(kHeadLength);
+        bodyOutput_.resize(kHeadLength);
+    }
+    if (length > kTailStart) {
+        tail_ = std::make_unique<UniformConvolver>(
+            taps + kTailStart, length - kTailStart, kTailBlock);
+        for (size_t slot = 0; slot < kTailSlots; ++slot) {
+            tailInputs_[slot].resize(kTailBlock);
+            tailOutputs_[slot].resize(kTailBlock);
+        }
+        tailPlaying_.resize(kTailBlock);
+    }
+    useBody_ = body_ != nullptr;
+    useTail_ = tail_ != nullptr;
+    if (tail_ && backgroundTail_) {
+        worker_ = TailWorker::get();
+        worker_->add(this);
+    }
+}
+
+Convolution::~Convolution() {
+    if (worker_) {
+        worker_->remove(this);
+    }
+}
+
+float Convolution::process(float x) {
+    processBuffer(&x, &x, 1);
+    return x;
+}
+
+std::unique_ptr<Process> Convolution::clone() const {
+    auto copy =
+        std::make_unique<Convolution>(impulseResponse_, backgroundTail_);
+    // The worker owns the tail's state while it has a job in hand
+    waitUntilComputed();
+    copy->history_ = history_;
+    if (body_) {
+        *copy->body_ = *body_;
+        copy->bodyInput_ = bodyInput_;
+        copy->bodyOutput_ = bodyOutput_;
+    }
+    copy->bodyFill_ = bodyFill_;
+    copy->qualityLevel_ = qualityLevel_;
+    copy->useBody_ = useBody_;
+    copy->useTail_ = useTail_;
+    if (tail_) {
+        *copy->tail_ = *tail_;
+        copy->tailInputs_ = tailInputs_;
+        copy->tailOutputs_ = tailOutputs_;
+        copy->tailRestarts_ = tailRestarts_;
+        copy->tailPlaying_ = tailPlaying_;
+        copy->tailFill_ = tailFill_;
+        copy->previousJob_ = previousJob_;
+        copy->restartTail_ = restartTail_;
+        // Equal, so the worker has nothing to do for the copy yet
+        copy->tailCompleted_.store(tailCompleted_.load());
+        copy->tailSubmitted_.store(tailSubmitted_.load());
+    }
+    return copy;
+}
+
+void Convolution::reset() {
+    waitUntilComputed();
+    history_.clear();
+    if (body_) {
+        body_->reset();
+        std::fill(bodyOutput_.begin(), bodyOutput_.end(), 0.0f);
+    }
+    if (tail_) {
+        tail_->reset();
+        std::fill(tailPlaying_.begin(), tailPlaying_.end(), 0.0f);
+        tailRestarts_.fill(false);
+    }
+    bodyFill_ = 0;
+    tailFill_ = 0;
+    previousJob_ = kNoJob;
+    restartTail_ = false;
+}
+
+void Convolution::processBuffer(const float* input, float* output,
+                                size_t nFrames) {
+    if (wakePending_) {
+        wakeWorker();
+    }
+    for (size_t done = 0; done < nFrames;) {
+        // Up to the end of the current body block
+        size_t n = std::min(nFrames - done, kHeadLength - bodyFill_);
+        const float* in = input + done;
+        history_.write(in, n);
+        if (useBody_) {
+            std::copy_n(in, n, bodyInput_.begin() + bodyFill_);
+        }
+        if (useTail_) {
+            const uint64_t job =
+                tailSubmitted_.load(std::memory_order_relaxed);
+            auto& collecting = tailInputs_[job % kTailSlots];
+            std::copy_n(in, n, collecting.begin() + tailFill_);
+        }
+
+        // Oldest first: the kHeadLength - 1 frames before the chunk, then it
+        const float* window = history_.span(0, n + kHeadLength - 1);
+        float* out = output + done;
+        for (size_t frame = 0; frame < n; ++frame) {
+            float sum = 0.0f;
+            for (size_t k = 0; k < kHeadLength; ++k) {
+                sum += head_[k] * window[frame + k];
+            }
+            out[frame] = sum;
+        }
+        if (useBody_) {
+            for (size_t frame = 0; frame < n; ++frame) {
+                out[frame] += bodyOutput_[bodyFill_ + frame];
+            }
+        }
+        if (useTail_) {
+            for (size_t frame = 0; frame < n; ++frame) {
+                out[frame] += tailPlaying_[tailFill_ + frame];
+            }
+        }
+        done += n;
+
+        bodyFill_ += n;
+        if (bodyFill_ == kHeadLength) {
+            if (useBody_) {
+                body_->process(bodyInput_.data(), bodyOutput_.data());
+            }
+            bodyFill_ = 0;
+        }
+        // Tail blocks stay aligned with body blocks while the tail is off
+        if (tail_ && (tailFill_ += n) == kTailBlock) {
+            if (useTail_) {
+                submitTail();
+            } else {
+                tailFill_ = 0;
+            }
+        }
+    }
+}
+
+unsigned Convolution::getFallbackCount() const {
+    return (body_ ? 1 : 0) + (tail_ ? 1 : 0);
+}
+
+void Convolution::setQualityLevel(unsigned level) {
+    qualityLevel_ = std::min(level, getFallbackCount());
+    const bool useTail = tail_ && qualityLevel_ == 0;
+    const bool useBody = body_ && qualityLevel_ < getFallbackCount();
+    if (useBody && !useBody_) {
+        body_->reset();
+        std::fill(bodyInput_.begin(), bodyInput_.end(), 0.0f);
+        std::fill(bodyOutput_.begin(), bodyOutput_.end(), 0.0f);
+    }
+    if (useTail && !useTail_) {
+        // The worker may still hold the tail, so it clears it with the next
+        // job; the collecting slot is ours
+        restartTail_ = true;
+        previousJob_ = kNoJob;
+        const uint64_t job = tailSubmitted_.load(std::memory_order_relaxed);
+        auto& collecting = tailInputs_[job % kTailSlots];
+        std::fill(collecting.begin(), collecting.end(), 0.0f);
+        std::fill(tailPlaying_.begin(), tailPlaying_.end(), 0.0f);
+    }
+    useBody_ = useBody;
+    useTail_ = useTail;
+}
+
+void Convolution::submitTail() {
+    const uint64_t job = tailSubmitted_.load(std::memory_order_relaxed);
+    int64_t submitted = kDroppedJob;
+    // The job's slot and the next one's must not be in the worker's hands
+    if (job - tailCompleted_.load(std::memory_order_acquire) <=
+        kTailSlots - 2) {
+        tailRestarts_[job % kTailSlots] = restartTail_;
+        restartTail_ = false;
+        if (backgroundTail_) {
+            tailSubmitted_.store(job + 1, std::memory_order_release);
+            wakeWorker();
+        } else {
+            runTailJob(job);
+            tailSubmitted_.store(job + 1, std::memory_order_relaxed);
+            tailCompleted_.store(job + 1, std::memory_order_relaxed);
+        }
+        submitted = int64_t(job);
+    } else {
+        restartTail_ = true;
+    }
+    tailFill_ = 0;
+    // The next block plays the output of the one before the last
+    if (previousJob_ >= 0 &&
+        uint64_t(previousJob_) <
+            tailCompleted_.load(std::memory_order_acquire)) {
+        std::copy_n(tailOutputs_[uint64_t(previousJob_) % kTailSlots].begin(),
+                    kTailBlock, tailPlaying_.begin());
+    } else if (previousJob_ != kNoJob) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    previousJob_ = submitted;
+}
+
+void Convolution::runTailJob(uint64_t job) {
+    const size_t slot = job % kTailSlots;
+    if (tailRestarts_[slot]) {
+        tail_->reset();
+    }
+    tail_->process(tailInputs_[slot].data(), tailOutputs_[slot].data());
+}
+
+void Convolution::runTailJobs() {
+    uint64_t job = tailCompleted_.load(std::memory_order_relaxed);
+    while (job < tailSubmitted_.load(std::memory_order_acquire)) {
+        runTailJob(job);
+        tailCompleted_.store(++job, std::memory_order_release);
+    }
+}
+
+void Convolution::wakeWorker() {
+    // Taking the worker's mutex orders the new job before its check for
+    // one; should another thread hold it, the notification may come too
+    // early, and is sent again on the next buffer rather than waiting
+    wakePending_ = !worker_->wake();
+}
+
+void Convolution::waitUntilComputed() const {
+    if (worker_) {
+        worker_->waitUntilComputed(*this);
+    }
+}
+
+size_t Convolution::getTailLength() const {
+    return impulseResponse_.empty() ? 0 : impulseResponse_.size() - 1;
+}
+
+size_t Convolution::getMemoryUsage() const {
+    size_t bytes = (head_.size() + history_.getStorageLength() +
+                    bodyInput_.size() + bodyOutput_.size()) *
+                   sizeof(float);
+    if (body_) {
+        bytes += body_->getMemoryUsage();
+    }
+    if (tail_) {
+        bytes += tail_->getMemoryUsage() +
+                 (2 * kTailSlots + 1) * kTailBlock * sizeof(float);
+    }
+    return bytes;
+}
+
+} // namespace blocks
@@ -0,0 +1,145 @@
+#ifndef BLOCKS_PROCESSES_CONVOLUTION_H
+#define BLOCKS_PROCESSES_CONVOLUTION_H
+
+#include "fft.h"
+#include "process.h"
+#include "shift_register.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace blocks {
+
+class TailWorker;
+
+/*
+Uniformly partitioned overlap-save convolution. Filters whole blocks of
+blockSize samples by the given taps; the output block for an input block is
+ready as soon as that block is complete.
+*/
+class UniformConvolver {
+  public:
+    UniformConvolver(const float* taps, size_t nTaps, size_t blockSize);
+    // Filters the next input block into blockSize output samples
+    void process(const float* input, float* output);
+    void reset();
+    size_t getMemoryUsage() const;
+
+  private:
+    size_t blockSize_;
+    size_t nPartitions_;
+    Fft fft_;
+    // Spectra of the taps, partition by partition
+    std::vector<std::complex<float>> partitions_;
+    // Spectra of the latest nPartitions_ input windows, a ring
+    std::vector<std::complex<float>> spectra_;
+    size_t newest_ = 0;
+    // The previous and the current input block
+    std::vector<float> window_;
+    std::vector<std::complex<float>> accumulator_;
+    std::vector<float> result_;
+};
+
+/*
+Convolves the signal with an impulse response, e.g. a room or a speaker
+cabinet, without latency. The response is split into three parts:
+- the first kHeadLength taps, applied directly per sample;
+- up to 2 * kTailBlock taps in partitions of kHeadLength, each block
+  convolved as soon as it is complete and played during the next one;
+- the rest in partitions of kTailBlock, each block convolved while the
+  next one is collected and played the block after.
+The tail runs on a worker thread unless backgroundTail is false; one worker
+serves every convolution in the program, and exists while any of them does.
+The worker sleeps until a block is handed to it, and the
+processing thread never waits for it: should a block's tail not be ready in
+time, the previous one plays again and counts as an overrun. Should the
+worker fall a whole ring of blocks behind, new blocks are dropped until it
+catches up, and the tail restarts from silence. Rendering faster than real
+time, call waitUntilComputed() between buffers.
+
+A multi-second response thus costs the processing thread kHeadLength
+multiply-adds and a few short transforms per sample. Under CPU overload the
+response is cut short: the first fallback level drops the tail, the next
+the middle part too. Parts coming back restart from silence.
+*/
+class Convolution : public Process {
+  public:
+    static constexpr size_t kHeadLength = 64;
+    static constexpr size_t kTailBlock = 1024;
+
+    explicit Convolution(std::vector<float> impulseResponse,
+                         bool backgroundTail = true);
+    ~Convolution() override;
+    Convolution(const Convolution&) = delete;
+    Convolution& operator=(const Convolution&) = delete;
+    float process(float x) override;
+    std::unique_ptr<Process> clone() const override;
+    void reset() override;
+    void processBuffer(const float* input, float* output,
+                       size_t nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    size_t getTailLength() const override;
+    size_t getMemoryUsage() const override;
+    unsigned getFallbackCount() const override;
+    void setQualityLevel(unsigned level) override;
+    // Blocks until the worker has convolved every block handed to it; for
+    // non-real-time threads
+    void waitUntilComputed() const;
+    // Tail blocks that replayed the previous one, their own not being ready
+    uint64_t getOverrunCount() const {
+        return overruns_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    friend class TailWorker;
+    // Jobs in flight or collecting; job j uses slot j % kTailSlots
+    static constexpr size_t kTailSlots = 4;
+    // previousJob_ before the first block, and for a dropped one
+    static constexpr int64_t kNoJob = -1;
+    static constexpr int64_t kDroppedJob = -2;
+    void submitTail();
+    void runTailJob(uint64_t job);
+    // On the worker: runs every job submitted so far
+    void runTailJobs();
+    bool hasTailJobs() const {
+        return tailCompleted_.load(std::memory_order_acquire) <
+               tailSubmitted_.load(std::memory_order_acquire);
+    }
+    void wakeWorker();
+    std::vector<float> impulseResponse_;
+    bool backgroundTail_;
+    unsigned qualityLevel_ = 0;
+    // Parts running at the current quality level
+    bool useBody_ = false;
+    bool useTail_ = false;
+    // Head taps reversed, so each output frame is one dot product
+    std::vector<float> head_;
+    ShiftRegister<float> history_;
+    std::unique_ptr<UniformConvolver> body_;
+    std::vector<float> bodyInput_;
+    std::vector<float> bodyOutput_;
+    size_t bodyFill_ = 0;
+    std::unique_ptr<UniformConvolver> tail_;
+    // The next job's slot collects its input; the worker reads the inputs
+    // of submitted jobs and writes their outputs, clearing the tail first
+    // where tailRestarts_ is set
+    std::array<std::vector<float>, kTailSlots> tailInputs_;
+    std::array<std::vector<float>, kTailSlots> tailOutputs_;
+    std::array<bool, kTailSlots> tailRestarts_{};
+    // Copy of the tail output being played, kept for replays
+    std::vector<float> tailPlaying_;
+    size_t tailFill_ = 0;
+    // Job of the block before the one collecting
+    int64_t previousJob_ = kNoJob;
+    bool restartTail_ = false;
+    // The worker may have missed the last wakeup
+    bool wakePending_ = false;
+    std::atomic<uint64_t> tailSubmitted_{0};
+    std::atomic<uint64_t> tailCompleted_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::shared_ptr<TailWorker> worker_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_CONVOLUTION_H
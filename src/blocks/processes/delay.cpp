@@ -1,13 +1,167 @@
 #include "delay.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
 
 namespace blocks {
 
-Delay::Delay(float time)
-    : nSamples_(size_t(kSampleRate * time)), register_(kMaxBufferSize) {}
+namespace {
+
+// Frames moved per bulk copy into and out of the delay line
+constexpr size_t kSpan = 256;
+
+size_t lineLength(float maxTime, double sampleRate) {
+    return size_t(std::lround(double(maxTime) * sampleRate)) + 1;
+}
+
+} // namespace
+
+Delay::Delay(float time, float maxTime, SampleStorage storage)
+    : time_(std::max(time, 0.0f)), maxTime_(std::max(maxTime, time_)),
+      storage_(storage), register_(0), compressed_(0) {
+    prepare(ProcessSpec{});
+}
 
 float Delay::process(float x) {
+    if (storage_ != SampleStorage::Float32) {
+        compressed_.push(encodeSample(storage_, x));
+        return decodeSample(storage_, compressed_.at(nSamples_));
+    }
     register_.push(x);
     return register_.at(nSamples_);
 }
 
+std::unique_ptr<Process> Delay::clone() const {
+    auto copy = std::make_unique<Delay>(*this);
+    // The pool belongs to this delay's thread
+    copy->allocator_ = nullptr;
+    return copy;
+}
+
+void Delay::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    allocator_ = spec.allocator;
+    size_t length = lineLength(maxTime_, sampleRate_);
+    if (storage_ == SampleStorage::Float32) {
+        register_ = ShiftRegister<float>(length, kSpan, spec.allocator);
+    } else {
+        compressed_ = ShiftRegister<uint16_t>(length, kSpan, spec.allocator);
+    }
+    nSamples_ = toSamples(time_);
+}
+
+size_t Delay::getRealtimeMemory(const ProcessSpec& spec) const {
+    size_t length = ShiftRegister<float>::getStorageLength(
+        lineLength(maxTime_, spec.sampleRate), kSpan);
+    return RealtimeAllocator::getChunkSize(length * getSampleSize());
+}
+
+size_t Delay::getMemoryUsage() const {
+    return storage_ == SampleStorage::Float32
+               ? register_.getStorageLength() * sizeof(float)
+               : compressed_.getStorageLength() * sizeof(uint16_t);
+}
+
+void Delay::reset() {
+    register_.clear();
+    compressed_.clear();
+}
+
+void Delay::setParameter(unsigned index, float value) {
+    if (index == 1) {
+        float maxTime = std::max(value, 0.0f);
+        size_t length = lineLength(maxTime, sampleRate_);
+        if (storage_ == SampleStorage::Float32) {
+            ShiftRegister<float> line(length, kSpan), retired;
+            setLine(line, retired, maxTime);
+        } else {
+            ShiftRegister<uint16_t> line(length, kSpan), retired;
+            setLine(line, retired, maxTime);
+        }
+        return;
+    }
+    if (index != 0) {
+        Process::setParameter(index, value);
+    }
+    time_ = std::clamp(value, 0.0f, maxTime_);
+    nSamples_ = toSamples(time_);
+}
+
+std::function<void()> Delay::prepareParameter(unsigned index, float value) {
+    if (index != 1) {
+        return Process::prepareParameter(index, value);
+    }
+    float maxTime = std::max(value, 0.0f);
+    size_t length = lineLength(maxTime, sampleRate_);
+    // Heap lines stay with the commit, freed off the processing thread
+    if (storage_ == SampleStorage::Float32) {
+        auto line = std::make_shared<ShiftRegister<float>>(length, kSpan);
+        auto retired = std::make_shared<ShiftRegister<float>>();
+        return [this, line, retired, maxTime] {
+            setLine(*line, *retired, maxTime);
+        };
+    }
+    auto line = std::make_shared<ShiftRegister<uint16_t>>(length, kSpan);
+    auto retired = std::make_shared<ShiftRegister<uint16_t>>();
+    return [this, line, retired, maxTime] {
+        setLine(*line, *retired, maxTime);
+    };
+}
+
+template <typename T>
+void Delay::setLine(ShiftRegister<T>& spare, ShiftRegister<T>& retired,
+                    float maxTime) {
+    ShiftRegister<T>* current = nullptr;
+    if constexpr (std::is_same_v<T, float>) {
+        current = &register_;
+    } else {
+        current = &compressed_;
+    }
+    const size_t length = spare.size();
+    // Pool chunks are freed and taken here, heap storage is handed back
+    retired.swap(*current);
+    if (retired.isPooled()) {
+        ShiftRegister<T>().swap(retired);
+    }
+    if (allocator_ != nullptr) {
+        *current = ShiftRegister<T>::fromPool(length, kSpan, allocator_);
+    }
+    if (!current->isPooled()) {
+        current->swap(spare);
+    }
+    maxTime_ = maxTime;
+    time_ = std::min(time_, maxTime_);
+    // The line may have been sized for another sample rate
+    nSamples_ = std::min(toSamples(time_), length - 1);
+}
+
+void Delay::processBuffer(const float* input, float* output, size_t nFrames) {
+    // Output frame i is the sample pushed nSamples_ before input frame i
+    if (storage_ != SampleStorage::Float32) {
+        uint16_t encoded[kSpan];
+        for (size_t done = 0; done < nFrames; done += kSpan) {
+            size_t n = std::min(kSpan, nFrames - done);
+            encodeSamples(storage_, input + done, encoded, n);
+            compressed_.write(encoded, n);
+            decodeSamples(storage_, compressed_.span(nSamples_, n),
+                          output + done, n);
+        }
+        return;
+    }
+    for (size_t done = 0; done < nFrames; done += kSpan) {
+        size_t n = std::min(kSpan, nFrames - done);
+        register_.write(input + done, n);
+        std::copy_n(register_.span(nSamples_, n), n, output + done);
+    }
+}
+
+size_t Delay::getSampleSize() const {
+    return storage_ == SampleStorage::Float32 ? sizeof(float)
+                                              : sizeof(uint16_t);
+}
+
+size_t Delay::toSamples(float time) const {
+    return size_t(std::lround(double(time) * sampleRate_));
+}
+
 } // namespace blocks
@@ -2,18 +2,61 @@
 #define BLOCKS_PROCESSES_DELAY_H
 
 #include "process.h"
+#include "sample_storage.h"
 #include "shift_register.h"
 
 namespace blocks {
 
+/*
+Delays the signal by a time given in seconds. The delay line holds maxTime
+(at least time) at the prepared sample rate; longer times set through
+setParameter() are clamped to it. Constructed delays are prepared for the
+default ProcessSpec.
+
+Within a block system the line is drawn from the graph's pool. Changing
+maxTime reallocates the line, which restarts empty; while streaming,
+change it through BlockSystem::setParameterAsync(). A heap line is built in
+the background in case the pool cannot serve the new length; the switch
+returns the old line to the pool and takes the new one from it on the
+processing thread, and heap lines are freed off it.
+
+Long lines may store samples as Float16 or BFloat16 (see SampleStorage),
+halving their memory and bandwidth.
+*/
 class Delay : public Process {
   public:
-    Delay(float time);
+    Delay(float time, float maxTime = 0.0f,
+          SampleStorage storage = SampleStorage::Float32);
     float process(float x) override;
+    std::unique_ptr<Process> clone() const override;
+    void prepare(const ProcessSpec& spec) override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    void reset() override;
+    void processBuffer(const float* input, float* output,
+                       size_t nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    // Parameter 0: delay time in seconds; 1: maximum delay time in seconds
+    void setParameter(unsigned index, float value) override;
+    std::function<void()> prepareParameter(unsigned index,
+                                           float value) override;
+    size_t getTailLength() const override { return nSamples_; }
 
   private:
-    size_t nSamples_;
+    size_t toSamples(float time) const;
+    size_t getSampleSize() const;
+    template <typename T>
+    void setLine(ShiftRegister<T>& spare, ShiftRegister<T>& retired,
+                 float maxTime);
+    float time_;
+    float maxTime_;
+    SampleStorage storage_;
+    double sampleRate_ = kDefaultSampleRate;
+    std::shared_ptr<RealtimeAllocator> allocator_;
+    size_t nSamples_ = 0;
+    // Only the line matching storage_ is sized
     ShiftRegister<float> register_;
+    ShiftRegister<uint16_t> compressed_;
 };
 
 } // namespace blocks
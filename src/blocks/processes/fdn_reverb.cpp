@@ -0,0 +1,210 @@
+#include "fdn_reverb.h"
+#include <algorithm>
+#include <cmath>
+
+namespace blocks {
+
+namespace {
+
+// Upper bound on frames per step, to keep the working buffers small
+constexpr size_t kSpan = 256;
+// Prime numbers of milliseconds
+const std::vector<float> kDefaultDelayTimes = {0.029f, 0.037f, 0.041f,
+                                               0.043f, 0.053f, 0.059f,
+                                               0.067f, 0.073f};
+
+bool isPowerOfTwo(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+} // namespace
+
+FdnReverb::FdnReverb(float decayTime, std::vector<float> delayTimes,
+                     float damping)
+    : decayTime_(std::max(decayTime, 1e-3f)),
+      delayTimes_(delayTimes.empty() ? kDefaultDelayTimes
+                                     : std::move(delayTimes)),
+      damping_(std::clamp(damping, 0.0f, 0.99f)) {
+    if (!isPowerOfTwo(delayTimes_.size())) {
+        throw invalid_operation_error(
+            "Feedback delay network needs a power of two lines");
+    }
+    prepare(ProcessSpec{});
+}
+
+float FdnReverb::process(float x) {
+    float y;
+    processBuffer(&x, &y, 1);
+    return y;
+}
+
+std::unique_ptr<Process> FdnReverb::clone() const {
+    return std::make_unique<FdnReverb>(*this);
+}
+
+void FdnReverb::prepare(const ProcessSpec& spec) {
+    sampleRate_ = spec.sampleRate;
+    const size_t nLines = delayTimes_.size();
+    lengths_.resize(nLines);
+    lines_.clear();
+    span_ = kSpan;
+    for (size_t i = 0; i < nLines; ++i) {
+        lengths_[i] = std::max<size_t>(
+            size_t(std::lround(double(delayTimes_[i]) * sampleRate_)), 1);
+        span_ = std::min(span_, lengths_[i]);
+    }
+    for (size_t i = 0; i < nLines; ++i) {
+        lines_.emplace_back(lengths_[i], span_, spec.allocator);
+    }
+    activeLines_ = nLines >> std::min(qualityLevel_, getFallbackCount());
+    gains_.resize(nLines);
+    lowpass_.assign(nLines, 0.0f);
+    outputs_.assign(nLines * span_, 0.0f);
+    feedback_.assign(nLines * span_, 0.0f);
+    updateGains();
+}
+
+size_t FdnReverb::getRealtimeMemory(const ProcessSpec& spec) const {
+    std::vector<size_t> lengths;
+    size_t span = kSpan;
+    for (float time : delayTimes_) {
+        lengths.push_back(std::max<size_t>(
+            size_t(std::lround(double(time) * spec.sampleRate)), 1));
+        span = std::min(span, lengths.back());
+    }
+    size_t bytes = 0;
+    for (size_t length : lengths) {
+        bytes += RealtimeAllocator::getChunkSize(
+            ShiftRegister<float>::getStorageLength(length, span) *
+            sizeof(float));
+    }
+    return bytes;
+}
+
+size_t FdnReverb::getMemoryUsage() const {
+    size_t floats = gains_.size() + lowpass_.size() + outputs_.size() +
+                    feedback_.size();
+    for (const auto& line : lines_) {
+        floats += line.getStorageLength();
+    }
+    return floats * sizeof(float);
+}
+
+void FdnReverb::reset() {
+    for (auto& line : lines_) {
+        line.clear();
+    }
+    std::fill(lowpass_.begin(), lowpass_.end(), 0.0f);
+}
+
+void FdnReverb::setParameter(unsigned index, float value) {
+    if (index == 0) {
+        decayTime_ = std::max(value, 1e-3f);
+    } else if (index == 1) {
+        damping_ = std::clamp(value, 0.0f, 0.99f);
+    } else {
+        Process::setParameter(index, value);
+    }
+    updateGains();
+}
+
+void FdnReverb::updateGains() {
+    // -60 dB over decayTime_, spread evenly over every sample of a line
+    for (size_t i = 0; i < lengths_.size(); ++i) {
+        gains_[i] = float(std::pow(
+            10.0, -3.0 * double(lengths_[i]) / (decayTime_ * sampleRate_)));
+    }
+}
+
+unsigned FdnReverb::getFallbackCount() const {
+    unsigned count = 0;
+    for (size_t n = delayTimes_.size(); n > 2; n /= 2) {
+        ++count;
+    }
+    return count;
+}
+
+void FdnReverb::setQualityLevel(unsigned level) {
+    qualityLevel_ = std::min(level, getFallbackCount());
+    const size_t active = lines_.size() >> qualityLevel_;
+    // Lines coming back hold what they had when they stopped
+    for (size_t i = activeLines_; i < active; ++i) {
+        lines_[i].clear();
+        lowpass_[i] = 0.0f;
+    }
+    activeLines_ = active;
+}
+
+size_t FdnReverb::getTailLength() const {
+    // -120 dB, once the longest line has passed the input on
+    return size_t(std::ceil(2.0 * decayTime_ * sampleRate_)) +
+           *std::max_element(lengths_.cbegin(), lengths_.cend());
+}
+
+void FdnReverb::processBuffer(const float* input, float* output,
+                              size_t nFrames) {
+    const size_t nLines = activeLines_;
+    const float scale = 1.0f / std::sqrt(float(nLines));
+    const float damping = damping_;
+    for (size_t done = 0; done < nFrames; done += span_) {
+        const size_t n = std::min(span_, nFrames - done);
+        // Every line output of the step was written before it began
+        for (size_t i = 0; i < nLines; ++i) {
+            std::copy_n(lines_[i].span(lengths_[i] - n, n), n,
+                        &outputs_[i * span_]);
+        }
+        if (damping > 0.0f) {
+            for (size_t i = 0; i < nLines; ++i) {
+                const float* y = &outputs_[i * span_];
+                float* f = &feedback_[i * span_];
+                float state = lowpass_[i];
+                for (size_t j = 0; j < n; ++j) {
+                    state = y[j] + damping * (state - y[j]);
+                    f[j] = state;
+                }
+                lowpass_[i] = state;
+            }
+        } else {
+            std::copy_n(outputs_.data(), nLines * span_, feedback_.data());
+        }
+        for (size_t i = 0; i < nLines; ++i) {
+            const float gain = gains_[i] * scale;
+            float* f = &feedback_[i * span_];
+            for (size_t j = 0; j < n; ++j) {
+                f[j] *= gain;
+            }
+        }
+        // Fast Walsh-Hadamard transform across the lines
+        for (size_t half = 1; half < nLines; half *= 2) {
+            for (size_t first = 0; first < nLines; first += 2 * half) {
+                for (size_t i = first; i < first + half; ++i) {
+                    float* a = &feedback_[i * span_];
+                    float* b = &feedback_[(i + half) * span_];
+                    for (size_t j = 0; j < n; ++j) {
+                        const float sum = a[j] + b[j];
+                        b[j] = a[j] - b[j];
+                        a[j] = sum;
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < nLines; ++i) {
+            float* f = &feedback_[i * span_];
+            for (size_t j = 0; j < n; ++j) {
+                f[j] += input[done + j];
+            }
+            lines_[i].write(f, n);
+        }
+        // The input of the step is read by now, so it may be the output
+        float* out = output + done;
+        for (size_t j = 0; j < n; ++j) {
+            out[j] = outputs_[j] * scale;
+        }
+        for (size_t i = 1; i < nLines; ++i) {
+            const float* y = &outputs_[i * span_];
+            for (size_t j = 0; j < n; ++j) {
+                out[j] += y[j] * scale;
+            }
+        }
+    }
+}
+
+} // namespace blocks
@@ -0,0 +1,71 @@
+#ifndef BLOCKS_PROCESSES_FDN_REVERB_H
+#define BLOCKS_PROCESSES_FDN_REVERB_H
+
+#include "process.h"
+#include "shift_register.h"
+#include <vector>
+
+namespace blocks {
+
+/*
+Feedback delay network reverb: the input feeds a set of delay lines whose
+outputs are mixed by a normalized Hadamard matrix and fed back, so every
+echo spreads into all lines and the echo density builds up quickly. The
+output is the sum of the line outputs, scaled by 1 / sqrt(lines).
+
+The number of lines must be a power of two; without delay times, eight
+mutually prime ones between 30 and 75 ms are used. Each line is attenuated
+so that the network decays by 60 dB in decayTime seconds. A damping in
+[0, 1) lowpasses the feedback, making high frequencies die away faster.
+
+No line feeds back within less than the shortest delay, so the network
+runs a whole span of frames at a time: each step of it is one loop over
+the span, lines stored one after another, and the matrix costs log2(lines)
+additions and subtractions per line and frame.
+
+Under CPU overload each fallback level halves the lines in use, down to
+two; the first ones keep running and the others restart silent.
+*/
+class FdnReverb : public Process {
+  public:
+    explicit FdnReverb(float decayTime, std::vector<float> delayTimes = {},
+                       float damping = 0.0f);
+    float process(float x) override;
+    std::unique_ptr<Process> clone() const override;
+    void prepare(const ProcessSpec& spec) override;
+    size_t getRealtimeMemory(const ProcessSpec& spec) const override;
+    size_t getMemoryUsage() const override;
+    void reset() override;
+    void processBuffer(const float* input, float* output,
+                       size_t nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    // Parameter 0: decay time in seconds; 1: damping
+    void setParameter(unsigned index, float value) override;
+    size_t getTailLength() const override;
+    unsigned getFallbackCount() const override;
+    void setQualityLevel(unsigned level) override;
+
+  private:
+    void updateGains();
+    float decayTime_;
+    std::vector<float> delayTimes_;
+    float damping_;
+    double sampleRate_ = kDefaultSampleRate;
+    std::vector<size_t> lengths_;
+    // Frames per step, at most the shortest line
+    size_t span_ = 1;
+    std::vector<ShiftRegister<float>> lines_;
+    unsigned qualityLevel_ = 0;
+    // The first activeLines_ lines run
+    size_t activeLines_ = 0;
+    std::vector<float> gains_;
+    // Damping filter state per line
+    std::vector<float> lowpass_;
+    // Line outputs, then the feedback, span_ frames per line
+    std::vector<float> outputs_;
+    std::vector<float> feedback_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_FDN_REVERB_H
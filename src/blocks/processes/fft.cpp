@@ -0,0 +1,108 @@
+#include "fft.h"
+#include "../exceptions.h"
+#include <cmath>
+
+namespace blocks {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+std::complex<float> rootOfUnity(size_t k, size_t n) {
+    double angle = -2.0 * kPi * double(k) / double(n);
+    return {float(std::cos(angle)), float(std::sin(angle))};
+}
+
+} // namespace
+
+Fft::Fft(size_t size) : size_(size) {
+    if (size < 4 || (size & (size - 1)) != 0) {
+        throw invalid_operation_error("FFT size must be a power of two >= 4");
+    }
+    const size_t half = size / 2;
+    bitReversed_.resize(half);
+    size_t bits = 0;
+    while ((size_t(1) << bits) < half) {
+        ++bits;
+    }
+    for (size_t i = 0; i < half; ++i) {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        bitReversed_[i] = reversed;
+    }
+    for (size_t k = 0; k < half / 2; ++k) {
+        twiddles_.push_back(rootOfUnity(k, half));
+    }
+    for (size_t k = 0; k <= half; ++k) {
+        realTwiddles_.push_back(rootOfUnity(k, size));
+    }
+    work_.resize(half);
+}
+
+void Fft::transform(std::complex<float>* data, bool inverse) const {
+    const size_t n = size_ / 2;
+    for (size_t i = 0; i < n; ++i) {
+        if (i < bitReversed_[i]) {
+            std::swap(data[i], data[bitReversed_[i]]);
+        }
+    }
+    for (size_t length = 2; length <= n; length *= 2) {
+        const size_t halfLength = length / 2;
+        const size_t stride = n / length;
+        for (size_t start = 0; start < n; start += length) {
+            for (size_t j = 0; j < halfLength; ++j) {
+                std::complex<float> w = twiddles_[j * stride];
+                if (inverse) {
+                    w = std::conj(w);
+                }
+                std::complex<float>& even = data[start + j];
+                std::complex<float>& odd = data[start + j + halfLength];
+                std::complex<float> product = multiply(odd, w);
+                odd = even - product;
+                even += product;
+            }
+        }
+    }
+}
+
+void Fft::forward(const float* input, std::complex<float>* spectrum) {
+    const size_t half = size_ / 2;
+    // Even samples as real parts, odd ones as imaginary parts
+    for (size_t i = 0; i < half; ++i) {
+        work_[i] = {input[2 * i], input[2 * i + 1]};
+    }
+    transform(work_.data(), false);
+    for (size_t k = 0; k <= half; ++k) {
+        std::complex<float> z = work_[k == half ? 0 : k];
+        std::complex<float> mirrored = std::conj(work_[k == 0 ? 0 : half - k]);
+        std::complex<float> even = 0.5f * (z + mirrored);
+        // (z - mirrored) / 2i
+        std::complex<float> difference = z - mirrored;
+        std::complex<float> odd = {0.5f * difference.imag(),
+                                   -0.5f * difference.real()};
+        spectrum[k] = even + multiply(realTwiddles_[k], odd);
+    }
+}
+
+void Fft::inverse(const std::complex<float>* spectrum, float* output) {
+    const size_t half = size_ / 2;
+    for (size_t k = 0; k < half; ++k) {
+        std::complex<float> x = spectrum[k];
+        std::complex<float> mirrored = std::conj(spectrum[half - k]);
+        std::complex<float> even = 0.5f * (x + mirrored);
+        std::complex<float> odd =
+            multiply(0.5f * (x - mirrored), std::conj(realTwiddles_[k]));
+        // even + i odd
+        work_[k] = {even.real() - odd.imag(), even.imag() + odd.real()};
+    }
+    transform(work_.data(), true);
+    const float scale = 1.0f / float(half);
+    for (size_t i = 0; i < half; ++i) {
+        output[2 * i] = work_[i].real() * scale;
+        output[2 * i + 1] = work_[i].imag() * scale;
+    }
+}
+
+} // namespace blocks
@@ -0,0 +1,49 @@
+#ifndef BLOCKS_PROCESSES_FFT_H
+#define BLOCKS_PROCESSES_FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace blocks {
+
+/*
+Fast Fourier transform of real signals whose length is a power of two (at
+least 4). The signal is packed into a complex transform of half the size,
+radix-2 with precomputed twiddles and bit reversal; no allocation happens
+after construction.
+*/
+class Fft {
+  public:
+    explicit Fft(size_t size);
+    size_t size() const { return size_; }
+    // Bins of the spectrum of a real signal: size() / 2 + 1
+    size_t getBinCount() const { return size_ / 2 + 1; }
+    // size() samples to getBinCount() bins, unnormalized
+    void forward(const float* input, std::complex<float>* spectrum);
+    // getBinCount() bins to size() samples; inverse(forward(x)) == x
+    void inverse(const std::complex<float>* spectrum, float* output);
+
+  private:
+    // In place over size() / 2 values; the inverse is unnormalized
+    void transform(std::complex<float>* data, bool inverse) const;
+    size_t size_;
+    std::vector<size_t> bitReversed_;
+    // e^(-2 pi i k / (size / 2)) for k < size / 4
+    std::vector<std::complex<float>> twiddles_;
+    // e^(-2 pi i k / size) for k <= size / 2
+    std::vector<std::complex<float>> realTwiddles_;
+    std::vector<std::complex<float>> work_;
+};
+
+// a * b, spelled out: std::complex's operator* guards against NaN and
+// infinity at a cost not worth paying per bin
+inline std::complex<float> multiply(std::complex<float> a,
+                                    std::complex<float> b) {
+    return {a.real() * b.real() - a.imag() * b.imag(),
+            a.real() * b.imag() + a.imag() * b.real()};
+}
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_FFT_H
@@ -6,4 +6,21 @@ Gain::Gain(float gain) : gain_(gain) {}
 
 float Gain::process(float x) { return x * gain_; }
 
+std::unique_ptr<Process> Gain::clone() const {
+    return std::make_unique<Gain>(*this);
+}
+
+void Gain::setParameter(unsigned index, float value) {
+    if (index != 0) {
+        Process::setParameter(index, value);
+    }
+    gain_ = value;
+}
+
+void Gain::processBuffer(const float* input, float* output, size_t nFrames) {
+    for (size_t i = 0; i < nFrames; ++i) {
+        output[i] = input[i] * gain_;
+    }
+}
+
 } // namespace blocks
\ No newline at end of file
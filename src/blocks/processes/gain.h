@@ -9,6 +9,12 @@ class Gain : public Process {
   public:
     Gain(float gain);
     float process(float x) override;
+    std::unique_ptr<Process> clone() const override;
+    void processBuffer(const float* input, float* output,
+                       size_t nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    // Parameter 0: gain
+    void setParameter(unsigned index, float value) override;
 
   private:
     float gain_;
@@ -1,13 +1,15 @@
 #ifndef BLOCKS_PROCESSES_PROCESS_H
 #define BLOCKS_PROCESSES_PROCESS_H
 
+#include "../exceptions.h"
+#include "process_spec.h"
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
 
 namespace blocks {
 
-constexpr size_t kMaxBufferSize = 131072;
-constexpr int kSampleRate = 44100;
-
 /*
 Basic building block of a processing pipeline. Represents a single process –
 with one input and one output. Various implementations can perform different
@@ -15,7 +17,44 @@ functions.
 */
 class Process {
   public:
+    virtual ~Process() = default;
     virtual float process(float x) = 0;
+    virtual std::unique_ptr<Process> clone() const = 0;
+    // Allocates state for the given stream; called before processing
+    virtual void prepare(const ProcessSpec& /*spec*/) {}
+    // Bytes of pool held at once while processing with the given spec, each
+    // allocation counted as RealtimeAllocator::getChunkSize() of its request
+    virtual size_t getRealtimeMemory(const ProcessSpec& /*spec*/) const {
+        return 0;
+    }
+    // Bytes of state held for processing, e.g. delay lines
+    virtual size_t getMemoryUsage() const { return 0; }
+    // Clears processing state, e.g. delay lines; must not allocate
+    virtual void reset() {}
+    virtual void processBuffer(const float* input, float* output,
+                               size_t nFrames) {
+        for (size_t i = 0; i < nFrames; ++i) {
+            output[i] = process(input[i]);
+        }
+    }
+    // True if processBuffer() accepts input == output.
+    virtual bool canProcessInPlace() const { return false; }
+    // Samples the output may stay non-zero after the input falls silent
+    virtual size_t getTailLength() const { return 0; }
+    // Number of cheaper modes for CPU overload, selected by setQualityLevel()
+    virtual unsigned getFallbackCount() const { return 0; }
+    // 0 - full quality, up to getFallbackCount(); must not allocate
+    virtual void setQualityLevel(unsigned /*level*/) {}
+    virtual void setParameter(unsigned index, float /*value*/) {
+        throw invalid_operation_error("Process has no parameter " +
+                                      std::to_string(index));
+    }
+    // Heavy part of a parameter change, run off the processing thread; the
+    // returned commit applies the result there without allocating
+    virtual std::function<void()> prepareParameter(unsigned index,
+                                                   float value) {
+        return [this, index, value] { setParameter(index, value); };
+    }
 };
 
 } // namespace blocks
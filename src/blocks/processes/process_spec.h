@@ -0,0 +1,30 @@
+#ifndef BLOCKS_PROCESSES_PROCESS_SPEC_H
+#define BLOCKS_PROCESSES_PROCESS_SPEC_H
+
+#include <memory>
+
+namespace blocks {
+
+class RealtimeAllocator;
+
+constexpr double kDefaultSampleRate = 44100.0;
+constexpr unsigned kDefaultMaxBlockSize = 512;
+
+/*
+Stream settings handed to prepare() before processing starts. Blocks and
+processes allocate everything they need there, so processing never does.
+maxBlockSize bounds the frames passed to a single processing call.
+
+Memory needed while processing comes from `allocator`, the pool of the graph
+being prepared, sized from everyone's getRealtimeMemory(). It is null outside
+a block system; it is only used on the processing thread.
+*/
+struct ProcessSpec {
+    double sampleRate = kDefaultSampleRate;
+    unsigned maxBlockSize = kDefaultMaxBlockSize;
+    std::shared_ptr<RealtimeAllocator> allocator;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_PROCESS_SPEC_H
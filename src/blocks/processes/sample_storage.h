@@ -0,0 +1,120 @@
+#ifndef BLOCKS_PROCESSES_SAMPLE_STORAGE_H
+#define BLOCKS_PROCESSES_SAMPLE_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.h"
+#include <cstring>
+
+namespace blocks {
+
+/*
+Number format of stored samples; processing always runs in float.
+
+Float16 (IEEE binary16) keeps 11 significant bits: a relative error below
+2^-11 (-66 dB) per store, values down to 6e-8 (-144 dBFS) and up to 65504.
+BFloat16 keeps float's range with 8 significant bits, below 2^-8 (-48 dB).
+For echoes and loops, where the stored signal sits under the dry one and
+feedback below unity shrinks earlier rounding, Float16 error stays below
+audibility; BFloat16 suits material that may exceed Float16's range.
+Both round to nearest even.
+*/
+enum class SampleStorage { Float32, Float16, BFloat16 };
+
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = uint16_t((bits >> 16) & 0x8000u);
+    bits &= 0x7fffffffu;
+    uint16_t half = 0;
+    if (bits >= 0x47800000u) {
+        // Out of range: Inf, and NaN stays NaN
+        half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (bits < 0x38800000u) {
+        // Subnormal: let the FPU round into the last mantissa bits
+        float magnitude = 0.0f;
+        std::memcpy(&magnitude, &bits, sizeof(bits));
+        magnitude += 0.5f;
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+        half = uint16_t(bits - 0x3f000000u);
+    } else {
+        uint32_t odd = (bits >> 13) & 1u;
+        bits += 0xc8000fffu + odd; // rebias the exponent and round
+        half = uint16_t(bits >> 13);
+    }
+    return sign | half;
+}
+
+inline float halfToFloat(uint16_t half) {
+    constexpr uint32_t kExponent = 0x7c00u << 13;
+    uint32_t bits = uint32_t(half & 0x7fffu) << 13;
+    uint32_t exponent = bits & kExponent;
+    bits += (127u - 15u) << 23;
+    float value = 0.0f;
+    if (exponent == kExponent) {
+        bits += (128u - 16u) << 23; // Inf or NaN
+    } else if (exponent == 0) {
+        // Subnormal halves are normal floats: renormalise arithmetically
+        bits += 1u << 23;
+        std::memcpy(&value, &bits, sizeof(bits));
+        value -= 6.103515625e-05f; // 2^-14
+        std::memcpy(&bits, &value, sizeof(bits));
+    }
+    bits |= uint32_t(half & 0x8000u) << 16;
+    std::memcpy(&value, &bits, sizeof(bits));
+    return value;
+}
+
+inline uint16_t floatToBFloat16(float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u) {
+        return uint16_t((bits >> 16) | 0x40u); // quiet NaN
+    }
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return uint16_t(bits >> 16);
+}
+
+inline float bFloat16ToFloat(uint16_t stored) {
+    uint32_t bits = uint32_t(stored) << 16;
+    float value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(bits));
+    return value;
+}
+
+inline uint16_t encodeSample(SampleStorage storage, float value) {
+    return storage == SampleStorage::BFloat16 ? floatToBFloat16(value)
+                                              : floatToHalf(value);
+}
+
+inline float decodeSample(SampleStorage storage, uint16_t stored) {
+    return storage == SampleStorage::BFloat16 ? bFloat16ToFloat(stored)
+                                              : halfToFloat(stored);
+}
+
+// Encodes n samples into Float16 or BFloat16
+inline void encodeSamples(SampleStorage storage, const float* input,
+                          uint16_t* output, size_t n) {
+    size_t i = 0;
+    if (storage == SampleStorage::Float16 && getCpuFeatures().f16c) {
+        i = encodeHalvesF16c(input, output, n);
+    }
+    for (; i < n; ++i) {
+        output[i] = encodeSample(storage, input[i]);
+    }
+}
+
+inline void decodeSamples(SampleStorage storage, const uint16_t* input,
+                          float* output, size_t n) {
+    size_t i = 0;
+    if (storage == SampleStorage::Float16 && getCpuFeatures().f16c) {
+        i = decodeHalvesF16c(input, output, n);
+    }
+    for (; i < n; ++i) {
+        output[i] = decodeSample(storage, input[i]);
+    }
+}
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_SAMPLE_STORAGE_H
@@ -1,35 +1,178 @@
 #ifndef BLOCKS_PROCESSES_SHIFT_REGISTER_H
 #define BLOCKS_PROCESSES_SHIFT_REGISTER_H
+#include "../realtime_allocator.h"
+#include "simd.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace blocks {
 
+/*
+Ring of the latest `size` samples; at(0) is the newest. Storage is a power of
+two, indexed with a mask, followed by a mirror of its first maxSpan slots.
+Thanks to the mirror any run of up to maxSpan consecutive samples is one
+contiguous span, so whole buffers are written and read with plain copies.
+
+Storage comes from `allocator` when given and able to serve it, from the heap
+otherwise; copies always live on the heap.
+*/
 template <typename T> class ShiftRegister {
   public:
-    ShiftRegister(size_t size) : size_(size), position_(0), data_(size) {}
+    // Size 0 and no storage, like a moved-from register
+    ShiftRegister() = default;
+    explicit ShiftRegister(
+        size_t size, size_t maxSpan = 1,
+        std::shared_ptr<RealtimeAllocator> allocator = nullptr)
+        : size_(size), maxSpan_(std::max<size_t>(maxSpan, 1)),
+          capacity_(roundUpToPowerOfTwo(size_ + maxSpan_ - 1)),
+          mask_(capacity_ - 1), position_(0) {
+        if (allocator != nullptr) {
+            pooled_ = PooledArray<T>(allocator, capacity_ + maxSpan_);
+        }
+        if (pooled_.empty()) {
+            heap_.resize(capacity_ + maxSpan_);
+            data_ = heap_.data();
+        } else {
+            data_ = pooled_.data();
+        }
+        std::fill_n(data_, capacity_ + maxSpan_, T());
+    }
+    /*
+    A register in the pool's memory, or an empty one without storage if the
+    pool cannot serve it; never touches the heap, so the processing thread
+    may call it. Clearing the storage takes time in proportion to its size.
+    */
+    static ShiftRegister
+    fromPool(size_t size, size_t maxSpan,
+             const std::shared_ptr<RealtimeAllocator>& allocator) {
+        ShiftRegister line;
+        PooledArray<T> storage(allocator, getStorageLength(size, maxSpan));
+        if (storage.empty()) {
+            return line;
+        }
+        line.size_ = size;
+        line.maxSpan_ = std::max<size_t>(maxSpan, 1);
+        line.capacity_ = roundUpToPowerOfTwo(size + line.maxSpan_ - 1);
+        line.mask_ = line.capacity_ - 1;
+        line.pooled_ = std::move(storage);
+        line.data_ = line.pooled_.data();
+        std::fill_n(line.data_, line.getStorageLength(), T());
+        return line;
+    }
+    ShiftRegister(const ShiftRegister& other)
+        : size_(other.size_), maxSpan_(other.maxSpan_),
+          capacity_(other.capacity_), mask_(other.mask_),
+          position_(other.position_),
+          heap_(other.data_, other.data_ + other.getStorageLength()),
+          data_(heap_.data()) {}
+    ShiftRegister(ShiftRegister&& other) noexcept { swap(other); }
+    ShiftRegister& operator=(ShiftRegister other) noexcept {
+        swap(other);
+        return *this;
+    }
+    void swap(ShiftRegister& other) noexcept {
+        std::swap(size_, other.size_);
+        std::swap(maxSpan_, other.maxSpan_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(mask_, other.mask_);
+        std::swap(position_, other.position_);
+        heap_.swap(other.heap_);
+        pooled_.swap(other.pooled_);
+        std::swap(data_, other.data_);
+    }
+
+    // Elements of storage behind a register of the given size and span
+    static size_t getStorageLength(size_t size, size_t maxSpan) {
+        maxSpan = std::max<size_t>(maxSpan, 1);
+        return roundUpToPowerOfTwo(size + maxSpan - 1) + maxSpan;
+    }
+    size_t getStorageLength() const { return capacity_ + maxSpan_; }
 
     void push(T new_data) {
-        ++position_;
-        position_ %= size_;
+        position_ = (position_ + 1) & mask_;
         data_[position_] = new_data;
+        data_[position_ < maxSpan_ ? position_ + capacity_ : position_] =
+            new_data;
+    }
+
+    // Pushes n <= maxSpan() samples, oldest first
+    void write(const T* samples, size_t n) {
+        assert(n <= maxSpan_);
+        size_t start = (position_ + 1) & mask_;
+        size_t first = std::min(n, capacity_ - start);
+        std::copy_n(samples, first, data_ + start);
+        std::copy_n(samples + first, n - first, data_);
+        // Refresh the mirror where the write touched its source
+        size_t mirrorStart = n > first ? 0 : start;
+        size_t mirrorEnd = n > first ? n - first : start + first;
+        if (mirrorStart < maxSpan_) {
+            std::copy(data_ + mirrorStart,
+                      data_ + std::min(mirrorEnd, maxSpan_),
+                      data_ + capacity_ + mirrorStart);
+        }
+        position_ = (position_ + n) & mask_;
     }
 
+    /*
+    The n <= maxSpan() consecutive samples from at(index + n - 1), the
+    oldest, to at(index), contiguous in memory.
+    */
+    const T* span(size_t index, size_t n) const {
+        assert(n <= maxSpan_ && index + n <= size_ + maxSpan_ - 1);
+        return data_ + ((position_ - index - (n - 1)) & mask_);
+    }
+
+    // out[i] = at(index[i]) for n indices below size() + maxSpan() - 1
+    void gather(const uint32_t* index, T* out, size_t n) const {
+        size_t i = 0;
+        if constexpr (std::is_same_v<T, float>) {
+            // 32-bit slot arithmetic: rings stay far below 2^32 samples
+            if (getCpuFeatures().avx2) {
+                i = gatherRingAvx2(data_, uint32_t(position_),
+                                   uint32_t(mask_), index, out, n);
+            }
+        }
+        for (; i < n; ++i) {
+            assert(index[i] < size_ + maxSpan_ - 1);
+            out[i] = data_[(position_ - index[i]) & mask_];
+        }
+    }
+
+    void clear() {
+        std::fill_n(data_, getStorageLength(), T());
+        position_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t maxSpan() const { return maxSpan_; }
+    // Whether the storage belongs to a RealtimeAllocator
+    bool isPooled() const { return !pooled_.empty(); }
+
     T at(size_t index) const {
         assert(index < size_);
-        size_t data_index = 0;
-        if (index <= position_) {
-            data_index = position_ - index;
-        } else {
-            data_index = position_ + size_ - index;
-        }
-        return data_[data_index];
+        return data_[(position_ - index) & mask_];
     }
 
   private:
-    size_t size_;
-    size_t position_;
-    std::vector<T> data_;
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t power = 1;
+        while (power < n) {
+            power *= 2;
+        }
+        return power;
+    }
+    size_t size_ = 0;
+    size_t maxSpan_ = 1;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    size_t position_ = 0;
+    std::vector<T> heap_;
+    PooledArray<T> pooled_;
+    T* data_ = nullptr;
 };
 
 } // namespace blocks
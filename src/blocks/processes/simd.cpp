@@ -0,0 +1,92 @@
+#include "simd.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                             \
+    (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define BLOCKS_HAS_X86_KERNELS 1
+#endif
+
+namespace blocks {
+
+namespace {
+
+CpuFeatures& currentFeatures() {
+    static CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+} // namespace
+
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+#if defined(BLOCKS_HAS_X86_KERNELS)
+    __builtin_cpu_init();
+    // The AVX check includes the system saving the 256-bit registers
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__builtin_cpu_supports("avx") &&
+        __get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        features.f16c = (ecx & bit_F16C) != 0;
+    }
+    features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return features;
+}
+
+const CpuFeatures& getCpuFeatures() { return currentFeatures(); }
+
+void setCpuFeatures(const CpuFeatures& features) {
+    currentFeatures() = features;
+}
+
+#if defined(BLOCKS_HAS_X86_KERNELS)
+
+__attribute__((target("avx,f16c"))) size_t
+encodeHalvesF16c(const float* input, uint16_t* output, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(input + i),
+                                       _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), half);
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c"))) size_t
+decodeHalvesF16c(const uint16_t* input, float* output, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i half =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        _mm256_storeu_ps(output + i, _mm256_cvtph_ps(half));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t
+gatherRingAvx2(const float* ring, uint32_t position, uint32_t mask,
+               const uint32_t* index, float* out, size_t n) {
+    const __m256i first = _mm256_set1_epi32(int(position));
+    const __m256i bits = _mm256_set1_epi32(int(mask));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i slot = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(index + i));
+        slot = _mm256_and_si256(_mm256_sub_epi32(first, slot), bits);
+        _mm256_storeu_ps(out + i, _mm256_i32gather_ps(ring, slot, 4));
+    }
+    return i;
+}
+
+#else
+
+size_t encodeHalvesF16c(const float*, uint16_t*, size_t) { return 0; }
+size_t decodeHalvesF16c(const uint16_t*, float*, size_t) { return 0; }
+size_t gatherRingAvx2(const float*, uint32_t, uint32_t, const uint32_t*,
+                      float*, size_t) {
+    return 0;
+}
+
+#endif
+
+} // namespace blocks
@@ -0,0 +1,39 @@
+#ifndef BLOCKS_PROCESSES_SIMD_H
+#define BLOCKS_PROCESSES_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace blocks {
+
+/*
+Instruction set extensions past the compiler's baseline that the kernels
+below use. The kernels are compiled for their extension whatever the build
+flags, and callers check getCpuFeatures() before each use, so one binary
+takes the fast path on the CPUs that have it and the portable one elsewhere.
+
+Features are detected on first use. Tests may turn them off with
+setCpuFeatures() to exercise the portable paths; never while processing.
+*/
+struct CpuFeatures {
+    bool f16c = false;
+    bool avx2 = false;
+};
+
+CpuFeatures detectCpuFeatures();
+const CpuFeatures& getCpuFeatures();
+void setCpuFeatures(const CpuFeatures& features);
+
+// Float16 conversions of n samples, rounding to nearest even; need F16C.
+// Convert whole groups of 8 and return how many samples that covers
+size_t encodeHalvesF16c(const float* input, uint16_t* output, size_t n);
+size_t decodeHalvesF16c(const uint16_t* input, float* output, size_t n);
+
+// out[i] = ring[(position - index[i]) & mask] for whole groups of 8 of the n
+// indices; needs AVX2. Returns how many were gathered
+size_t gatherRingAvx2(const float* ring, uint32_t position, uint32_t mask,
+                      const uint32_t* index, float* out, size_t n);
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_SIMD_H
@@ -0,0 +1,139 @@
+#include "waveshaper.h"
+#include <algorithm>
+#include <cmath>
+
+namespace blocks {
+
+namespace {
+
+constexpr unsigned kDefaultSegments = 256;
+constexpr unsigned kDefaultDegree = 9;
+// Frames per pass, shaped into a local buffer the table cannot alias
+constexpr size_t kChunk = 64;
+constexpr double kPi = 3.14159265358979323846;
+
+// Clamps x to [low, high]; unlike std::clamp, NaN maps to low
+inline float clampInput(float x, float low, float high) {
+    x = x > low ? x : low;
+    return x < high ? x : high;
+}
+
+/*
+Monomial coefficients in u = x / range of the Chebyshev interpolant through
+degree + 1 Chebyshev nodes.
+*/
+std::vector<float> fitPolynomial(const std::function<float(float)>& transfer,
+                                 float range, unsigned degree) {
+    const unsigned n = degree + 1;
+    std::vector<double> samples(n);
+    for (unsigned j = 0; j < n; ++j) {
+        double node = std::cos(kPi * (j + 0.5) / n);
+        samples[j] = transfer(float(node * range));
+    }
+    // sum of c_k T_k(u), expanded with T_k+1 = 2u T_k - T_k-1
+    std::vector<double> monomial(n, 0.0);
+    std::vector<double> previous(n, 0.0), current(n, 0.0), next(n, 0.0);
+    previous[0] = 1.0;
+    if (n > 1) {
+        current[1] = 1.0;
+    }
+    for (unsigned k = 0; k < n; ++k) {
+        double c = 0.0;
+        for (unsigned j = 0; j < n; ++j) {
+            c += samples[j] * std::cos(kPi * k * (j + 0.5) / n);
+        }
+        c *= (k == 0 ? 1.0 : 2.0) / n;
+        const auto& chebyshev = k == 0 ? previous : current;
+        for (unsigned i = 0; i < n; ++i) {
+            monomial[i] += c * chebyshev[i];
+        }
+        if (k > 0) {
+            for (unsigned i = 0; i < n; ++i) {
+                next[i] = (i > 0 ? 2.0 * current[i - 1] : 0.0) - previous[i];
+            }
+            previous.swap(current);
+            current.swap(next);
+        }
+    }
+    return std::vector<float>(monomial.cbegin(), monomial.cend());
+}
+
+} // namespace
+
+Waveshaper::Waveshaper(const std::function<float(float)>& transfer,
+                       float range, ShaperMode mode, unsigned size)
+    : mode_(mode), range_(std::max(range, 1e-6f)) {
+    if (mode_ == ShaperMode::Polynomial) {
+        coefficients_ = fitPolynomial(transfer, range_,
+                                      size == 0 ? kDefaultDegree : size);
+        scale_ = 1.0f / range_;
+        return;
+    }
+    const unsigned segments = size == 0 ? kDefaultSegments : size;
+    table_.resize(segments + 1);
+    for (unsigned i = 0; i <= segments; ++i) {
+        double x = -range_ + 2.0 * range_ * i / segments;
+        table_[i] = transfer(float(x));
+    }
+    scale_ = float(segments) / (2.0f * range_);
+}
+
+float Waveshaper::process(float x) {
+    float y;
+    processBuffer(&x, &y, 1);
+    return y;
+}
+
+std::unique_ptr<Process> Waveshaper::clone() const {
+    return std::make_unique<Waveshaper>(*this);
+}
+
+void Waveshaper::processBuffer(const float* input, float* output,
+                               size_t nFrames) {
+    // Locals, which the outputs cannot alias
+    const float range = range_;
+    const float scale = scale_;
+    if (mode_ == ShaperMode::Polynomial) {
+        // Horner's rule a chunk at a time, so the loop over frames is inner
+        const float* c = coefficients_.data();
+        const size_t degree = coefficients_.size() - 1;
+        float u[kChunk];
+        float y[kChunk];
+        for (size_t done = 0; done < nFrames; done += kChunk) {
+            const size_t n = std::min(kChunk, nFrames - done);
+            for (size_t i = 0; i < n; ++i) {
+                u[i] = clampInput(input[done + i] * scale, -1.0f, 1.0f);
+                y[i] = c[degree];
+            }
+            for (size_t k = degree; k-- > 0;) {
+                for (size_t i = 0; i < n; ++i) {
+                    y[i] = y[i] * u[i] + c[k];
+                }
+            }
+            std::copy_n(y, n, output + done);
+        }
+        return;
+    }
+    const float* table = table_.data();
+    const int last = int(table_.size()) - 2;
+    float y[kChunk];
+    for (size_t done = 0; done < nFrames; done += kChunk) {
+        const size_t n = std::min(kChunk, nFrames - done);
+        for (size_t i = 0; i < n; ++i) {
+            float x = clampInput(input[done + i], -range, range);
+            // Never negative, so truncating floors; the top end falls into
+            // the last segment at fraction 1
+            float position = (x + range) * scale;
+            int index = std::min(int(position), last);
+            float fraction = position - float(index);
+            y[i] = table[index] + fraction * (table[index + 1] - table[index]);
+        }
+        std::copy_n(y, n, output + done);
+    }
+}
+
+size_t Waveshaper::getMemoryUsage() const {
+    return (table_.size() + coefficients_.size()) * sizeof(float);
+}
+
+} // namespace blocks
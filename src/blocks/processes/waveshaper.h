@@ -0,0 +1,51 @@
+#ifndef BLOCKS_PROCESSES_WAVESHAPER_H
+#define BLOCKS_PROCESSES_WAVESHAPER_H
+
+#include "process.h"
+#include <functional>
+#include <vector>
+
+namespace blocks {
+
+/*
+How a waveshaper stores its transfer function:
+- Table keeps `size` linear segments, exact at their ends; suits any shape,
+  kinks and hard clipping included.
+- Polynomial keeps a degree `size` Chebyshev fit evaluated by Horner's
+  rule; no memory traffic, suits smooth curves such as tanh.
+*/
+enum class ShaperMode { Table, Polynomial };
+
+/*
+Maps every sample through a transfer function, e.g. a saturation curve or a
+chain of them. The function is sampled once, at construction, over
+[-range, range]; inputs beyond it are clamped to the range, NaN to its low
+end. Processing is branch-free, so whole buffers vectorize and a chain of
+curves costs the same as one. A size of 0 picks 256 segments or degree 9.
+*/
+class Waveshaper : public Process {
+  public:
+    Waveshaper(const std::function<float(float)>& transfer,
+               float range = 1.0f, ShaperMode mode = ShaperMode::Table,
+               unsigned size = 0);
+    float process(float x) override;
+    std::unique_ptr<Process> clone() const override;
+    void processBuffer(const float* input, float* output,
+                       size_t nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    size_t getMemoryUsage() const override;
+
+  private:
+    ShaperMode mode_;
+    float range_;
+    // Table: inputs to segment positions; Polynomial: inputs to [-1, 1]
+    float scale_;
+    // The function at the segment ends
+    std::vector<float> table_;
+    // Constant term first
+    std::vector<float> coefficients_;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_PROCESSES_WAVESHAPER_H
@@ -0,0 +1,161 @@
+#include "realtime_allocator.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace blocks {
+
+namespace {
+
+constexpr size_t kHugePageSize = size_t(2) << 20;
+constexpr size_t kFreeBit = 1;
+
+size_t roundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+RealtimeAllocator::RealtimeAllocator(size_t capacity)
+    : capacity_(roundUp(capacity, kAlignment)) {
+    bool huge = capacity_ >= kHugePageSize;
+    size_t alignment = huge ? kHugePageSize : kAlignment;
+    size_t bytes = std::max(roundUp(capacity_, alignment), alignment);
+    auto* storage =
+        static_cast<unsigned char*>(std::aligned_alloc(alignment, bytes));
+    if (storage == nullptr) {
+        throw std::bad_alloc();
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge) {
+        // Best effort: fewer TLB misses walking long delay lines
+        madvise(storage, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    // Fault every page in now rather than on the processing thread
+    std::memset(storage, 0, bytes);
+    storage_.reset(storage);
+}
+
+void RealtimeAllocator::FreeStorage::operator()(unsigned char* storage) const {
+    std::free(storage);
+}
+
+size_t RealtimeAllocator::getSizeClass(size_t chunkSize) {
+    size_t sizeClass = 0;
+    while ((kMinChunkSize << (sizeClass + 1)) <= chunkSize &&
+           sizeClass + 1 < kClassCount) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+size_t RealtimeAllocator::getChunkSize(size_t bytes) {
+    if (bytes > SIZE_MAX - 2 * kAlignment) {
+        return SIZE_MAX;
+    }
+    return std::max(roundUp(bytes + kHeaderSize, kAlignment), kMinChunkSize);
+}
+
+void RealtimeAllocator::insertFree(Chunk* chunk, size_t size) {
+    Chunk*& head = freeLists_[getSizeClass(size)];
+    chunk->size = size | kFreeBit;
+    getLinks(chunk) = FreeLinks{head, nullptr};
+    if (head != nullptr) {
+        getLinks(head).previous = chunk;
+    }
+    head = chunk;
+}
+
+void RealtimeAllocator::removeFree(Chunk* chunk) {
+    const FreeLinks links = getLinks(chunk);
+    if (links.previous != nullptr) {
+        getLinks(links.previous).next = links.next;
+    } else {
+        freeLists_[getSizeClass(chunk->size & ~kFreeBit)] = links.next;
+    }
+    if (links.next != nullptr) {
+        getLinks(links.next).previous = links.previous;
+    }
+    chunk->size &= ~kFreeBit;
+}
+
+void* RealtimeAllocator::allocate(size_t bytes) {
+    const size_t chunkSize = getChunkSize(bytes);
+    if (chunkSize == SIZE_MAX) {
+        return nullptr;
+    }
+    Chunk* chunk = nullptr;
+    // Heads of the classes above the request's own are large enough
+    for (size_t sizeClass = getSizeClass(chunkSize);
+         sizeClass < kClassCount && chunk == nullptr; ++sizeClass) {
+        Chunk* head = freeLists_[sizeClass];
+        if (head != nullptr && (head->size & ~kFreeBit) >= chunkSize) {
+            chunk = head;
+        }
+    }
+    if (chunk != nullptr) {
+        removeFree(chunk);
+        const size_t rest = chunk->size - chunkSize;
+        if (rest >= kMinChunkSize) {
+            // Free chunks never border the untouched rest, so one follows
+            const size_t offset = getOffset(chunk) + chunkSize;
+            Chunk* split = new (getChunk(offset)) Chunk{0, chunkSize};
+            getChunk(offset + rest)->previous = rest;
+            insertFree(split, rest);
+            chunk->size = chunkSize;
+        }
+    } else {
+        if (capacity_ - top_ < chunkSize) {
+            return nullptr;
+        }
+        chunk = new (getChunk(top_)) Chunk{chunkSize, topPrevious_};
+        top_ += chunkSize;
+        topPrevious_ = chunkSize;
+    }
+    used_ += chunk->size;
+    return reinterpret_cast<unsigned char*>(chunk) + kHeaderSize;
+}
+
+void RealtimeAllocator::deallocate(void* pointer) {
+    if (pointer == nullptr) {
+        return;
+    }
+    auto* chunk = reinterpret_cast<Chunk*>(
+        static_cast<unsigned char*>(pointer) - kHeaderSize);
+    size_t offset = getOffset(chunk);
+    assert(offset < top_ && (chunk->size & kFreeBit) == 0);
+    size_t size = chunk->size;
+    used_ -= size;
+    if (offset + size < top_) {
+        Chunk* next = getChunk(offset + size);
+        if (next->size & kFreeBit) {
+            removeFree(next);
+            size += next->size;
+        }
+    }
+    if (chunk->previous != 0) {
+        Chunk* before = getChunk(offset - chunk->previous);
+        if (before->size & kFreeBit) {
+            removeFree(before);
+            offset -= before->size;
+            size += before->size;
+            chunk = before;
+        }
+    }
+    if (offset + size == top_) {
+        // Back to the untouched rest, after a chunk in use or none
+        top_ = offset;
+        topPrevious_ = chunk->previous;
+        return;
+    }
+    insertFree(chunk, size);
+    getChunk(offset + size)->previous = size;
+}
+
+} // namespace blocks
@@ -0,0 +1,141 @@
+#ifndef BLOCKS_REALTIME_ALLOCATOR_H
+#define BLOCKS_REALTIME_ALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace blocks {
+
+/*
+Fixed pool for the memory of a graph's blocks: state drawn in prepare() and
+whatever they need while processing. All memory is reserved and touched on
+construction, in huge pages where the system offers them for large pools;
+allocate() and deallocate() take bounded time, never lock and never call into
+the system.
+
+Requests take a chunk of exactly their size plus a small header, rounded to
+the alignment (see getChunkSize()), so a pool sized by summing chunks holds
+prepare-time state without slack. Free chunks sit on a list per power-of-two
+size class, the largest not above them; a request is served by the first
+list head, from its own class up, that is large enough, and what it does
+not need is split off as a free chunk of its own. Freed chunks merge with
+free neighbours, and with the untouched rest of the pool where they border
+it, so memory given back serves requests of any size: a line shrunk and
+grown back fits where it was. When neither the free lists nor the untouched
+rest can serve a request, allocate() returns nullptr.
+
+Not thread-safe: a pool belongs to the thread processing its graph.
+*/
+class RealtimeAllocator {
+  public:
+    static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+    explicit RealtimeAllocator(size_t capacity);
+    RealtimeAllocator(const RealtimeAllocator&) = delete;
+    RealtimeAllocator& operator=(const RealtimeAllocator&) = delete;
+
+    // Aligned to kAlignment; nullptr if the pool is exhausted
+    void* allocate(size_t bytes);
+    void deallocate(void* pointer);
+    // Pool bytes taken by a request for `bytes`
+    static size_t getChunkSize(size_t bytes);
+    size_t getCapacity() const { return capacity_; }
+    // Bytes in chunks currently handed out
+    size_t getUsed() const { return used_; }
+
+  private:
+    static constexpr size_t kHeaderSize = kAlignment;
+    static constexpr size_t kMinChunkSize = 2 * kHeaderSize;
+    static constexpr size_t kClassCount = 48;
+    // Starts every chunk; free chunks keep their list links right after it
+    struct Chunk {
+        // Header included; the low bit marks free chunks
+        size_t size;
+        // Size of the chunk right before in the pool, 0 for the first
+        size_t previous;
+    };
+    struct FreeLinks {
+        Chunk* next;
+        Chunk* previous;
+    };
+    static_assert(sizeof(Chunk) <= kHeaderSize &&
+                      sizeof(FreeLinks) <= kMinChunkSize - kHeaderSize,
+                  "Chunk header and links fit the minimum chunk");
+    // Class of the free list holding chunks of chunkSize bytes
+    static size_t getSizeClass(size_t chunkSize);
+    Chunk* getChunk(size_t offset) {
+        return reinterpret_cast<Chunk*>(storage_.get() + offset);
+    }
+    size_t getOffset(const Chunk* chunk) const {
+        return size_t(reinterpret_cast<const unsigned char*>(chunk) -
+                      storage_.get());
+    }
+    static FreeLinks& getLinks(Chunk* chunk) {
+        return *reinterpret_cast<FreeLinks*>(
+            reinterpret_cast<unsigned char*>(chunk) + kHeaderSize);
+    }
+    void insertFree(Chunk* chunk, size_t size);
+    void removeFree(Chunk* chunk);
+    struct FreeStorage {
+        void operator()(unsigned char* storage) const;
+    };
+    size_t capacity_;
+    std::unique_ptr<unsigned char[], FreeStorage> storage_;
+    size_t top_ = 0;
+    // Size of the chunk ending at top_, 0 if none
+    size_t topPrevious_ = 0;
+    size_t used_ = 0;
+    std::array<Chunk*, kClassCount> freeLists_{};
+};
+
+/*
+Owning array of trivially copyable elements drawn from a RealtimeAllocator,
+which it keeps alive. Move-only; elements start uninitialised. An array the
+pool could not serve is empty. Blocks draw their arrays afresh in prepare(),
+as the pool may be replaced there.
+*/
+template <typename T> class PooledArray {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "PooledArray holds trivially copyable types");
+
+  public:
+    PooledArray() = default;
+    PooledArray(std::shared_ptr<RealtimeAllocator> allocator, size_t size)
+        : allocator_(std::move(allocator)),
+          data_(static_cast<T*>(allocator_->allocate(size * sizeof(T)))),
+          size_(data_ != nullptr ? size : 0) {}
+    PooledArray(PooledArray&& other) noexcept { swap(other); }
+    PooledArray& operator=(PooledArray&& other) noexcept {
+        PooledArray(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~PooledArray() {
+        if (data_ != nullptr) {
+            allocator_->deallocate(data_);
+        }
+    }
+    void swap(PooledArray& other) noexcept {
+        std::swap(allocator_, other.allocator_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t index) { return data_[index]; }
+    const T& operator[](size_t index) const { return data_[index]; }
+
+  private:
+    std::shared_ptr<RealtimeAllocator> allocator_;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_REALTIME_ALLOCATOR_H
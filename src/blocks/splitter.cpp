@@ -1,4 +1,5 @@
 #include "splitter.h"
+#include <algorithm>
 
 namespace blocks {
 
@@ -10,4 +11,17 @@ void Splitter::evaluate() {
     }
 }
 
+void Splitter::evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                              uint nFrames) {
+    for (uint i = 0; i < outputs_.size(); ++i) {
+        if (outputs[i] != inputs[0]) {
+            std::copy_n(inputs[0], nFrames, outputs[i]);
+        }
+    }
+}
+
+std::shared_ptr<Block> Splitter::clone() const {
+    return std::make_shared<Splitter>(*this);
+}
+
 } // namespace blocks
@@ -9,6 +9,10 @@ class Splitter : public BlockAtomic {
   public:
     Splitter(uint nOutputs);
     void evaluate() override;
+    void evaluateBuffer(InputBuffers_t inputs, OutputBuffers_t outputs,
+                        uint nFrames) override;
+    bool canProcessInPlace() const override { return true; }
+    std::shared_ptr<Block> clone() const override;
 };
 
 } // namespace blocks
@@ -0,0 +1,69 @@
+#ifndef BLOCKS_SPSC_RING_H
+#define BLOCKS_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace blocks {
+
+/*
+Lock-free single-producer single-consumer ring of preallocated slots. The
+producer fills a slot in place between beginWrite() and endWrite(), the
+consumer reads it between beginRead() and endRead(). Nothing allocates after
+construction.
+*/
+template <typename T> class SpscRing {
+  public:
+    explicit SpscRing(size_t capacity, const T& prototype = T())
+        : slots_(capacity + 1, prototype) {}
+
+    T* beginWrite() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (next(tail) == head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[tail];
+    }
+    void endWrite() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store(next(tail), std::memory_order_release);
+    }
+
+    T* beginRead() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[head];
+    }
+    void endRead() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        head_.store(next(head), std::memory_order_release);
+    }
+
+    // Producer side: overwrites the slots the consumer has released
+    void recycle(const T& value) {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t used = (tail + slots_.size() - head) % slots_.size();
+        for (size_t i = 0; i < slots_.size() - used; ++i) {
+            slots_[(tail + i) % slots_.size()] = value;
+        }
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) ==
+               tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    size_t next(size_t index) const { return (index + 1) % slots_.size(); }
+    std::vector<T> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace blocks
+
+#endif // BLOCKS_SPSC_RING_H
@@ -35,6 +35,7 @@ int main() {
     }
     client.setInputDevice(inputDevices[3]);
     client.setOutputDevice(outputDevices[8]);
+    client.setSampleRate(client.getOutputDevice().defaultSampleRate);
 
     float dry = 0.6f;
     float wet = 1.0f;
@@ -43,148 +44,78 @@ int main() {
     float wet2 = 0.6f;
     float feedback2 = 0.6f;
     float time2 = 0.8f / 3.0f;
-    auto dryGain = std::make_shared<blocks::ProcessBlock>(
-        std::make_unique<blocks::Gain>(dry));
-    auto wetGain = std::make_shared<blocks::ProcessBlock>(
-        std::make_unique<blocks::Gain>(wet));
-    auto feedbackGain = std::make_shared<blocks::ProcessBlock>(
-        std::make_unique<blocks::Gain>(feedback));
+    auto input = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0f));
     auto delay = std::make_shared<blocks::ProcessBlock>(
         std::make_unique<blocks::Delay>(time));
-    auto wet2Gain = std::make_shared<blocks::ProcessBlock>(
-        std::make_unique<blocks::Gain>(wet2));
-    auto feedback2Gain = std::make_shared<blocks::ProcessBlock>(
-        std::make_unique<blocks::Gain>(feedback2));
     auto delay2 = std::make_shared<blocks::ProcessBlock>(
         std::make_unique<blocks::Delay>(time2));
-    auto splitter1 = std::make_shared<blocks::Splitter>(3);
-    auto splitter2 = std::make_shared<blocks::Splitter>(2);
-    auto splitter3 = std::make_shared<blocks::Splitter>(2);
-    auto adder1 = std::make_shared<blocks::Adder>(2);
-    auto adder2 = std::make_shared<blocks::Adder>(3);
-    auto adder3 = std::make_shared<blocks::Adder>(2);
+    auto mix = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0f));
+    auto wet2Gain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(wet2));
     auto effect = std::make_shared<blocks::BlockSystem>();
-    dryGain->setName("dryGain");
-    wetGain->setName("wetGain");
-    feedbackGain->setName("feedbackGain");
+    input->setName("input");
     delay->setName("delay");
-    splitter1->setName("splitter1");
-    splitter2->setName("splitter2");
-    adder1->setName("adder1");
-    adder2->setName("adder2");
+    delay2->setName("delay2");
+    mix->setName("mix");
+    wet2Gain->setName("wet2Gain");
     effect->setName("effect");
-    effect->addBlock(dryGain);
-    effect->addBlock(wetGain);
-    effect->addBlock(feedbackGain);
+    effect->addBlock(input);
     effect->addBlock(delay);
-    effect->addBlock(adder1);
-    effect->addBlock(adder2);
-    effect->addBlock(splitter1);
-    effect->addBlock(splitter2);
-    effect->addBlock(adder3);
     effect->addBlock(delay2);
-    effect->addBlock(splitter3);
+    effect->addBlock(mix);
     effect->addBlock(wet2Gain);
-    effect->addBlock(feedback2Gain);
-    i = 0;
     blocks::Connection connection;
-    connection.source.block = splitter1;
-    connection.source.port = 0;
-    connection.target.block = dryGain;
-    connection.target.port = 0;
+    connection.source.block = input;
+    connection.target.block = mix;
+    connection.gain = dry;
     effect->addConnection(connection);
-    connection.source.block = splitter1;
-    connection.source.port = 1;
-    connection.target.block = adder1;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = dryGain;
-    connection.source.port = 0;
-    connection.target.block = adder2;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = adder1;
-    connection.source.port = 0;
+    connection.source.block = input;
     connection.target.block = delay;
-    connection.target.port = 0;
+    connection.gain = 1.0f;
     effect->addConnection(connection);
     connection.source.block = delay;
-    connection.source.port = 0;
-    connection.target.block = splitter2;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = splitter2;
-    connection.source.port = 0;
-    connection.target.block = wetGain;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = wetGain;
-    connection.source.port = 0;
-    connection.target.block = adder2;
-    connection.target.port = 1;
-    effect->addConnection(connection);
-    connection.source.block = splitter2;
-    connection.source.port = 1;
-    connection.target.block = feedbackGain;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = feedbackGain;
-    connection.source.port = 0;
-    connection.target.block = adder1;
-    connection.target.port = 1;
+    connection.target.block = delay;
+    connection.gain = feedback;
     effect->addConnection(connection);
-    connection.source.block = splitter1;
-    connection.source.port = 2;
-    connection.target.block = adder3;
-    connection.target.port = 0;
+    connection.source.block = delay;
+    connection.target.block = mix;
+    connection.gain = wet;
     effect->addConnection(connection);
-    connection.source.block = adder3;
-    connection.source.port = 0;
+    connection.source.block = input;
     connection.target.block = delay2;
-    connection.target.port = 0;
+    connection.gain = 1.0f;
     effect->addConnection(connection);
     connection.source.block = delay2;
-    connection.source.port = 0;
-    connection.target.block = splitter3;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = splitter3;
-    connection.source.port = 0;
-    connection.target.block = feedback2Gain;
-    connection.target.port = 0;
+    connection.target.block = delay2;
+    connection.gain = feedback2;
     effect->addConnection(connection);
-    connection.source.block = splitter3;
-    connection.source.port = 1;
+    connection.source.block = delay2;
     connection.target.block = wet2Gain;
-    connection.target.port = 0;
-    effect->addConnection(connection);
-    connection.source.block = wet2Gain;
-    connection.source.port = 0;
-    connection.target.block = adder2;
-    connection.target.port = 2;
-    // effect->addConnection(connection);
-    connection.source.block = feedback2Gain;
-    connection.source.port = 0;
-    connection.target.block = adder3;
-    connection.target.port = 1;
+    connection.gain = 1.0f;
     effect->addConnection(connection);
     blocks::Port port;
-    port.block = splitter1;
+    port.block = input;
     port.port = 0;
     effect->addInput(port);
-    port.block = adder2;
+    port.block = mix;
     port.port = 0;
     effect->addOutput(port);
     port.block = wet2Gain;
     port.port = 0;
     effect->addOutput(port);
 
+    blocks::ProcessSpec spec;
+    spec.sampleRate = client.getSampleRate();
+    spec.maxBlockSize = client.getBufferSize();
+    effect->prepare(spec);
+    blocks::LoadGovernor governor(effect);
     client.setCallback(
-        [&](const std::vector<float>& in, std::vector<float>& out) {
-            effect->setInput(in[1]);
-            effect->evaluate();
-            out[1] = effect->getOutput(0);
-            out[0] = effect->getOutput(1);
+        [&](const float* const* in, float* const* out, uint nFrames) {
+            const float* inputs[] = {in[1]};
+            float* outputs[] = {out[1], out[0]};
+            governor.evaluateBuffer(inputs, outputs, nFrames);
         });
     client.startStream();
     while (true) {
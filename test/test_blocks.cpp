@@ -1,6 +1,15 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <numeric>
+#include <thread>
 
 #include <../src/blocks/blocks.h>
 
@@ -244,11 +253,23 @@ TEST_CASE("Add connection to already connected target port", "[blocks]") {
     connection.target.port = 0;
     blockSystem->addConnection(connection);
     connection.source.block = blockB;
-    REQUIRE_THROWS_AS(blockSystem->addConnection(connection),
-                      blocks::base_exception);
+    connection.gain = 0.5f;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = blockA;
+    blockSystem->addInput(port);
+    port.block = blockB;
+    blockSystem->addInput(port);
+    port.block = blockC;
+    blockSystem->addOutput(port);
+    blockSystem->setInput(1.0f, 0);
+    blockSystem->setInput(4.0f, 1);
+    blockSystem->evaluate();
+    REQUIRE_THAT(blockSystem->getOutput(),
+                 Catch::Matchers::WithinAbs(3.0f, 1e-4f));
 }
 
-TEST_CASE("Add connection from already connected target port", "[blocks]") {
+TEST_CASE("Add connection from already connected source port", "[blocks]") {
     auto blockA = std::make_shared<blocks::ProcessBlock>(
         std::make_unique<blocks::Gain>(1.0));
     auto blockB = std::make_shared<blocks::ProcessBlock>(
@@ -265,8 +286,20 @@ TEST_CASE("Add connection from already connected target port", "[blocks]") {
     connection.target.block = blockC;
     blockSystem->addConnection(connection);
     connection.target.block = blockB;
-    REQUIRE_THROWS_AS(blockSystem->addConnection(connection),
-                      blocks::base_exception);
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = blockA;
+    blockSystem->addInput(port);
+    port.block = blockB;
+    blockSystem->addOutput(port);
+    port.block = blockC;
+    blockSystem->addOutput(port);
+    blockSystem->setInput(2.0f);
+    blockSystem->evaluate();
+    CHECK_THAT(blockSystem->getOutput(0),
+               Catch::Matchers::WithinAbs(2.0f, 1e-4f));
+    REQUIRE_THAT(blockSystem->getOutput(1),
+                 Catch::Matchers::WithinAbs(2.0f, 1e-4f));
 }
 
 TEST_CASE("Add multiple valid connections", "[blocks]") {
@@ -468,7 +501,7 @@ TEST_CASE("Add input to block system, illegal port", "[blocks]") {
     REQUIRE_THROWS_AS(blockSystem->addInput(port), blocks::base_exception);
 }
 
-TEST_CASE("Add input to block system, port already connected", "[blocks]") {
+TEST_CASE("Add input to block system, port already an input", "[blocks]") {
     auto block0 = std::make_shared<blocks::ProcessBlock>(
         std::make_unique<blocks::Gain>(1.0));
     auto block1 = std::make_shared<blocks::ProcessBlock>(
@@ -491,6 +524,7 @@ TEST_CASE("Add input to block system, port already connected", "[blocks]") {
     blocks::Port port;
     port.block = block1;
     port.port = 0;
+    blockSystem->addInput(port);
     REQUIRE_THROWS_AS(blockSystem->addInput(port), blocks::base_exception);
 }
 
@@ -566,7 +600,7 @@ TEST_CASE("Add output to block system, illegal port", "[blocks]") {
     REQUIRE_THROWS_AS(blockSystem->addOutput(port), blocks::base_exception);
 }
 
-TEST_CASE("Add output to block system, port already connected", "[blocks]") {
+TEST_CASE("Add output to block system, port already an output", "[blocks]") {
     auto block0 = std::make_shared<blocks::ProcessBlock>(
         std::make_unique<blocks::Gain>(1.0));
     auto block1 = std::make_shared<blocks::ProcessBlock>(
@@ -588,6 +622,7 @@ TEST_CASE("Add output to block system, port already connected", "[blocks]") {
 
     blocks::Port port;
     port.block = block1;
+    blockSystem->addOutput(port);
     REQUIRE_THROWS_AS(blockSystem->addOutput(port), blocks::base_exception);
 }
 
@@ -721,9 +756,17 @@ TEST_CASE("Connect to a port that is already an input", "[blocks]") {
     blockSystem->addInput(port);
     connection.source.block = block2;
     connection.target.block = block0;
-
-    REQUIRE_THROWS_AS(blockSystem->addConnection(connection),
-                      blocks::base_exception);
+    blockSystem->addConnection(connection);
+    port.block = block2;
+    blockSystem->addOutput(port);
+    // The feedback edge reaches block0 one sample later
+    blockSystem->setInput(1.0f);
+    blockSystem->evaluate();
+    CHECK_THAT(blockSystem->getOutput(),
+               Catch::Matchers::WithinAbs(1.0f, 1e-4f));
+    blockSystem->evaluate();
+    REQUIRE_THAT(blockSystem->getOutput(),
+                 Catch::Matchers::WithinAbs(2.0f, 1e-4f));
 }
 
 TEST_CASE("Connect to a port that is already an output", "[blocks]") {
@@ -750,9 +793,8 @@ TEST_CASE("Connect to a port that is already an output", "[blocks]") {
     blockSystem->addOutput(port);
     connection.source.block = block2;
     connection.target.block = block0;
-
-    REQUIRE_THROWS_AS(blockSystem->addConnection(connection),
-                      blocks::base_exception);
+    blockSystem->addConnection(connection);
+    REQUIRE(blockSystem->hasConnection(connection));
 }
 
 TEST_CASE("Add and remove multiple outputs to block system", "[blocks]") {
@@ -1210,4 +1252,2389 @@ TEST_CASE("Connect block with multiple ports", "[blocks]") {
     connection.source.port = 1;
     connection.target.block = block1;
     blockSystem->addConnection(connection);
-}
\ No newline at end of file
+}
+TEST_CASE("Evaluate block system over a buffer", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto block0 = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(2.0));
+    auto block1 = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(4.0));
+    blockSystem->addBlock(block0);
+    blockSystem->addBlock(block1);
+    blocks::Connection connection;
+    connection.source.block = block0;
+    connection.target.block = block1;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = block0;
+    blockSystem->addInput(port);
+    port.block = block1;
+    blockSystem->addOutput(port);
+    std::vector<float> input(64), output(64);
+    for (uint i = 0; i < input.size(); ++i) {
+        input[i] = float(i);
+    }
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blockSystem->evaluateBuffer(inputs, outputs, 64);
+    for (uint i = 0; i < output.size(); ++i) {
+        REQUIRE_THAT(output[i], Catch::Matchers::WithinAbs(8.0f * i, 1e-4f));
+    }
+}
+
+namespace {
+
+std::shared_ptr<blocks::BlockSystem> makeEchoSystem() {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto splitter = std::make_shared<blocks::Splitter>(2);
+    auto adder = std::make_shared<blocks::Adder>(2);
+    auto delay = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(5.0f / blocks::kDefaultSampleRate));
+    auto feedback = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(0.5));
+    blockSystem->addBlock(adder);
+    blockSystem->addBlock(delay);
+    blockSystem->addBlock(splitter);
+    blockSystem->addBlock(feedback);
+    blocks::Connection connection;
+    connection.source.block = adder;
+    connection.target.block = delay;
+    blockSystem->addConnection(connection);
+    connection.source.block = delay;
+    connection.target.block = splitter;
+    blockSystem->addConnection(connection);
+    connection.source.block = splitter;
+    connection.source.port = 1;
+    connection.target.block = feedback;
+    blockSystem->addConnection(connection);
+    connection.source.block = feedback;
+    connection.source.port = 0;
+    connection.target.block = adder;
+    connection.target.port = 1;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = adder;
+    blockSystem->addInput(port);
+    port.block = splitter;
+    blockSystem->addOutput(port);
+    return blockSystem;
+}
+
+} // namespace
+
+TEST_CASE("Buffered evaluation of a feedback loop matches per-sample",
+          "[blocks]") {
+    auto perSample = makeEchoSystem();
+    auto buffered = makeEchoSystem();
+    std::vector<float> input(100, 0.0f), output(100);
+    input[0] = 1.0f;
+    input[37] = -1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    buffered->evaluateBuffer(inputs, outputs, 50);
+    inputs[0] += 50;
+    outputs[0] += 50;
+    buffered->evaluateBuffer(inputs, outputs, 50);
+    for (uint i = 0; i < input.size(); ++i) {
+        perSample->setInput(input[i]);
+        perSample->evaluate();
+        REQUIRE_THAT(output[i],
+                     Catch::Matchers::WithinAbs(perSample->getOutput(), 1e-6f));
+    }
+    auto echo = std::find_if(output.cbegin() + 1, output.cend(),
+                             [](float x) { return x != 0.0f; });
+    REQUIRE(echo != output.cend());
+    REQUIRE_THAT(*echo, Catch::Matchers::WithinAbs(1.0f, 1e-6f));
+}
+
+TEST_CASE("Scratch buffers are reused along a chain", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    std::vector<std::shared_ptr<blocks::Block>> chain;
+    for (uint i = 0; i < 16; ++i) {
+        chain.emplace_back(std::make_shared<blocks::ProcessBlock>(
+            std::make_unique<blocks::Gain>(2.0)));
+        blockSystem->addBlock(chain.back());
+    }
+    blocks::Connection connection;
+    for (uint i = 1; i < chain.size(); ++i) {
+        connection.source.block = chain[i - 1];
+        connection.target.block = chain[i];
+        blockSystem->addConnection(connection);
+    }
+    blocks::Port port;
+    port.block = chain.front();
+    blockSystem->addInput(port);
+    port.block = chain.back();
+    blockSystem->addOutput(port);
+    // The silent buffer plus one buffer processed in place
+    REQUIRE(blockSystem->getScratchBufferCount() == 2);
+    blockSystem->setInput(1.0f);
+    blockSystem->evaluate();
+    REQUIRE_THAT(blockSystem->getOutput(),
+                 Catch::Matchers::WithinAbs(65536.0f, 1e-2f));
+}
+
+TEST_CASE("Scratch buffers grow with graph width", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto splitter = std::make_shared<blocks::Splitter>(3);
+    auto adder = std::make_shared<blocks::Adder>(3);
+    blockSystem->addBlock(splitter);
+    blockSystem->addBlock(adder);
+    blocks::Connection connection;
+    for (uint i = 0; i < 3; ++i) {
+        auto gain = std::make_shared<blocks::ProcessBlock>(
+            std::make_unique<blocks::Gain>(float(i + 1)));
+        blockSystem->addBlock(gain);
+        connection.source.block = splitter;
+        connection.source.port = i;
+        connection.target.block = gain;
+        connection.target.port = 0;
+        blockSystem->addConnection(connection);
+        connection.source.block = gain;
+        connection.source.port = 0;
+        connection.target.block = adder;
+        connection.target.port = i;
+        blockSystem->addConnection(connection);
+    }
+    blocks::Port port;
+    port.block = splitter;
+    blockSystem->addInput(port);
+    port.block = adder;
+    blockSystem->addOutput(port);
+    REQUIRE(blockSystem->getScratchBufferCount() == 4);
+    blockSystem->setInput(1.0f);
+    blockSystem->evaluate();
+    REQUIRE_THAT(blockSystem->getOutput(),
+                 Catch::Matchers::WithinAbs(6.0f, 1e-4f));
+}
+
+TEST_CASE("Connection gains replace splitters and adders", "[blocks]") {
+    auto reference = makeEchoSystem();
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto delay = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(5.0f / blocks::kDefaultSampleRate));
+    blockSystem->addBlock(delay);
+    blocks::Connection connection;
+    connection.source.block = delay;
+    connection.target.block = delay;
+    connection.gain = 0.5f;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = delay;
+    blockSystem->addInput(port);
+    blockSystem->addOutput(port);
+    for (uint i = 0; i < 40; ++i) {
+        float x = (i == 0) ? 1.0f : 0.0f;
+        reference->setInput(x);
+        reference->evaluate();
+        blockSystem->setInput(x);
+        blockSystem->evaluate();
+        REQUIRE_THAT(blockSystem->getOutput(),
+                     Catch::Matchers::WithinAbs(reference->getOutput(), 1e-6f));
+    }
+}
+
+TEST_CASE("Cloned block system shares its plan and copies state",
+          "[blocks]") {
+    auto original = makeEchoSystem();
+    original->updateEvaluationSequence();
+    original->setInput(1.0f);
+    original->evaluate();
+    original->setInput(0.0f);
+    auto copy =
+        std::dynamic_pointer_cast<blocks::BlockSystem>(original->clone());
+    REQUIRE(copy != nullptr);
+    REQUIRE(copy->getExecutionPlan() == original->getExecutionPlan());
+    for (uint i = 0; i < 40; ++i) {
+        original->evaluate();
+        copy->evaluate();
+        REQUIRE_THAT(copy->getOutput(),
+                     Catch::Matchers::WithinAbs(original->getOutput(), 1e-6f));
+    }
+    // Instances evolve independently
+    copy->setInput(1.0f);
+    copy->evaluate();
+    original->evaluate();
+    auto copyChain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    copy->addBlock(copyChain);
+    REQUIRE(copy->getExecutionPlan() != original->getExecutionPlan());
+    REQUIRE_FALSE(original->hasBlock(copyChain));
+}
+
+namespace {
+
+// Chain of gains and delays with a dry path skipping to the last block
+std::shared_ptr<blocks::BlockSystem> makeLongChain(uint length) {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    std::vector<std::shared_ptr<blocks::Block>> chain;
+    for (uint i = 0; i < length; ++i) {
+        std::unique_ptr<blocks::Process> process;
+        if (i % 2 == 0) {
+            process = std::make_unique<blocks::Gain>(0.9);
+        } else {
+            process = std::make_unique<blocks::Delay>(
+                float(i / blocks::kDefaultSampleRate));
+        }
+        chain.emplace_back(
+            std::make_shared<blocks::ProcessBlock>(std::move(process)));
+        blockSystem->addBlock(chain.back());
+    }
+    blocks::Connection connection;
+    for (uint i = 1; i < length; ++i) {
+        connection.source.block = chain[i - 1];
+        connection.target.block = chain[i];
+        blockSystem->addConnection(connection);
+    }
+    connection.source.block = chain.front();
+    connection.target.block = chain.back();
+    connection.gain = 0.25f;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = chain.front();
+    blockSystem->addInput(port);
+    port.block = chain.back();
+    blockSystem->addOutput(port);
+    return blockSystem;
+}
+
+} // namespace
+
+TEST_CASE("Pipeline matches direct evaluation delayed by its latency",
+          "[blocks]") {
+    constexpr uint nFrames = 16;
+    constexpr uint nCalls = 12;
+    auto direct = makeLongChain(12);
+    auto pipelined = std::dynamic_pointer_cast<blocks::BlockSystem>(
+        direct->clone());
+    blocks::Pipeline pipeline(pipelined, 4, nFrames);
+    REQUIRE(pipeline.getStageCount() == 4);
+    REQUIRE(pipeline.getLatency() == 3);
+    std::vector<float> input(nFrames * nCalls), expected(input.size()),
+        output(input.size());
+    for (uint i = 0; i < input.size(); ++i) {
+        input[i] = float(i % 7) - 3.0f;
+    }
+    for (uint call = 0; call < nCalls; ++call) {
+        const float* inputs[] = {input.data() + call * nFrames};
+        float* directOutputs[] = {expected.data() + call * nFrames};
+        float* pipelineOutputs[] = {output.data() + call * nFrames};
+        direct->evaluateBuffer(inputs, directOutputs, nFrames);
+        pipeline.process(inputs, pipelineOutputs, nFrames);
+    }
+    const uint latency = pipeline.getLatency() * nFrames;
+    for (uint i = 0; i < latency; ++i) {
+        REQUIRE(output[i] == 0.0f);
+    }
+    for (uint i = latency; i < output.size(); ++i) {
+        REQUIRE_THAT(output[i],
+                     Catch::Matchers::WithinAbs(expected[i - latency], 1e-5f));
+    }
+    std::vector<float> shorter(nFrames / 2);
+    const float* inputs[] = {shorter.data()};
+    float* outputs[] = {shorter.data()};
+    REQUIRE_THROWS_AS(pipeline.process(inputs, outputs, nFrames / 2),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("Idle pipeline stages sleep instead of spinning", "[blocks]") {
+    constexpr uint nFrames = 16;
+    blocks::Pipeline pipeline(makeLongChain(12), 4, nFrames);
+    REQUIRE(pipeline.getStageCount() == 4);
+    std::vector<float> input(nFrames, 1.0f), output(nFrames);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    for (uint call = 0; call < 8; ++call) {
+        pipeline.process(inputs, outputs, nFrames);
+    }
+    // Three waiting workers would burn about 0.6 s of CPU time here
+    const std::clock_t start = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const double busy = double(std::clock() - start) / CLOCKS_PER_SEC;
+    REQUIRE(busy < 0.05);
+    // and wake up for the next buffer
+    std::fill(output.begin(), output.end(), 0.0f);
+    pipeline.process(inputs, outputs, nFrames);
+    REQUIRE(output != std::vector<float>(nFrames, 0.0f));
+}
+
+TEST_CASE("Pipeline keeps a feedback loop within one stage", "[blocks]") {
+    auto echo = makeEchoSystem();
+    auto reference = makeEchoSystem();
+    blocks::Pipeline pipeline(echo, 4, 32);
+    REQUIRE(pipeline.getStageCount() == 1);
+    std::vector<float> input(32, 0.0f), expected(32), output(32);
+    input[0] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* referenceOutputs[] = {expected.data()};
+    float* outputs[] = {output.data()};
+    reference->evaluateBuffer(inputs, referenceOutputs, 32);
+    pipeline.process(inputs, outputs, 32);
+    REQUIRE(output == expected);
+}
+
+TEST_CASE("Control-rate blocks run once per divisor and ramp to audio rate",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto control0 = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(2.0));
+    auto control1 = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(2.0));
+    auto audio = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    blockSystem->addBlock(control0);
+    blockSystem->addBlock(control1);
+    blockSystem->addBlock(audio);
+    blocks::Connection connection;
+    connection.source.block = control0;
+    connection.target.block = control1;
+    blockSystem->addConnection(connection);
+    connection.source.block = control1;
+    connection.target.block = audio;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = control0;
+    blockSystem->addInput(port);
+    port.block = audio;
+    blockSystem->addOutput(port);
+    blockSystem->setRateDivisor(control0, 4);
+    blockSystem->setRateDivisor(control1, 4);
+    REQUIRE_THROWS_AS(blockSystem->setRateDivisor(control0, 0),
+                      blocks::invalid_operation_error);
+    auto perSample = std::dynamic_pointer_cast<blocks::BlockSystem>(
+        blockSystem->clone());
+    std::vector<float> input(40), output(40);
+    for (uint i = 0; i < input.size(); ++i) {
+        input[i] = float(i);
+    }
+    // Uneven chunks: the control phase carries across calls
+    for (uint done = 0; done < input.size(); done += 5) {
+        const float* inputs[] = {input.data() + done};
+        float* outputs[] = {output.data() + done};
+        blockSystem->evaluateBuffer(inputs, outputs, 5);
+    }
+    // Held between control blocks, ramped once into the audio-rate block
+    for (uint i = 3; i < output.size(); ++i) {
+        REQUIRE_THAT(output[i],
+                     Catch::Matchers::WithinAbs(4.0f * (i - 3.0f), 1e-4f));
+    }
+    for (uint i = 0; i < input.size(); ++i) {
+        perSample->setInput(input[i]);
+        perSample->evaluate();
+        REQUIRE_THAT(perSample->getOutput(),
+                     Catch::Matchers::WithinAbs(output[i], 1e-4f));
+    }
+}
+
+TEST_CASE("Events change parameters on their exact frame", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto first = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    auto second = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    blockSystem->addBlock(first);
+    blockSystem->addBlock(second);
+    blocks::Connection connection;
+    connection.source.block = first;
+    connection.target.block = second;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = first;
+    blockSystem->addInput(port);
+    port.block = second;
+    blockSystem->addOutput(port);
+    std::vector<float> input(64, 1.0f), output(64);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blocks::Events_t events{{10, first, 0, 2.0f}, {40, second, 0, 3.0f}};
+    blockSystem->evaluateBuffer(inputs, outputs, 64, events);
+    for (uint i = 0; i < output.size(); ++i) {
+        float expected = (i < 10 ? 1.0f : 2.0f) * (i < 40 ? 1.0f : 3.0f);
+        REQUIRE(output[i] == expected);
+    }
+    // The new values persist
+    blockSystem->evaluateBuffer(inputs, outputs, 64);
+    REQUIRE(output[0] == 6.0f);
+
+    blocks::Events_t unsorted{{20, first, 0, 1.0f}, {10, first, 0, 1.0f}};
+    REQUIRE_THROWS_AS(
+        blockSystem->evaluateBuffer(inputs, outputs, 64, unsorted),
+        blocks::invalid_operation_error);
+    blocks::Events_t late{{64, first, 0, 1.0f}};
+    REQUIRE_THROWS_AS(blockSystem->evaluateBuffer(inputs, outputs, 64, late),
+                      blocks::invalid_operation_error);
+    blocks::Events_t unknownParameter{{0, first, 1, 1.0f}};
+    REQUIRE_THROWS_AS(
+        blockSystem->evaluateBuffer(inputs, outputs, 64, unknownParameter),
+        blocks::invalid_operation_error);
+}
+
+TEST_CASE("Events inside a feedback loop match per-sample changes",
+          "[blocks]") {
+    auto buffered = makeEchoSystem();
+    auto perSample = std::dynamic_pointer_cast<blocks::BlockSystem>(
+        buffered->clone());
+    // The echo system's last block is the feedback gain
+    auto feedback = buffered->viewBlocks().back();
+    auto perSampleFeedback = perSample->viewBlocks().back();
+    std::vector<float> input(60, 0.0f), output(60);
+    input[0] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blocks::Events_t events{{23, feedback, 0, -0.9f}};
+    buffered->evaluateBuffer(inputs, outputs, 60, events);
+    for (uint i = 0; i < input.size(); ++i) {
+        if (i == 23) {
+            perSampleFeedback->setParameter(0, -0.9f);
+        }
+        perSample->setInput(input[i]);
+        perSample->evaluate();
+        REQUIRE_THAT(output[i],
+                     Catch::Matchers::WithinAbs(perSample->getOutput(), 1e-6f));
+    }
+}
+
+namespace {
+
+// Pass-through block counting how often it is asked to process
+class CountingBlock : public blocks::BlockAtomic {
+  public:
+    CountingBlock() : BlockAtomic(1, 1) {}
+    void evaluate() override { outputs_[0] = inputs_[0]; }
+    void evaluateBuffer(blocks::InputBuffers_t inputs,
+                        blocks::OutputBuffers_t outputs,
+                        uint nFrames) override {
+        ++calls;
+        std::copy_n(inputs[0], nFrames, outputs[0]);
+    }
+    std::shared_ptr<blocks::Block> clone() const override {
+        return std::make_shared<CountingBlock>(*this);
+    }
+    uint calls = 0;
+};
+
+} // namespace
+
+TEST_CASE("Blocks are skipped once their inputs outlast the tail",
+          "[blocks]") {
+    constexpr float delayTime = 6.0f / blocks::kDefaultSampleRate;
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto delay = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(delayTime));
+    auto counter = std::make_shared<CountingBlock>();
+    blockSystem->addBlock(delay);
+    blockSystem->addBlock(counter);
+    blocks::Connection connection;
+    connection.source.block = delay;
+    connection.target.block = counter;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = delay;
+    blockSystem->addInput(port);
+    port.block = counter;
+    blockSystem->addOutput(port);
+    REQUIRE(delay->getTailLength() > 0);
+    REQUIRE(counter->getTailLength() == 0);
+
+    blocks::Delay reference(delayTime);
+    constexpr uint nFrames = 4;
+    std::vector<float> input(nFrames * 40, 0.0f), output(input.size());
+    input[1] = 1.0f;
+    input[100] = -2.0f;
+    input[102] = 0.5f;
+    for (uint done = 0; done < input.size(); done += nFrames) {
+        const float* inputs[] = {input.data() + done};
+        float* outputs[] = {output.data() + done};
+        blockSystem->evaluateBuffer(inputs, outputs, nFrames);
+        if (done == 96) {
+            // Only the buffer carrying the first echo was processed
+            REQUIRE(counter->calls == 1);
+        }
+    }
+    for (uint i = 0; i < input.size(); ++i) {
+        REQUIRE(output[i] == reference.process(input[i]));
+    }
+}
+
+TEST_CASE("Bypassed blocks are wired through and leave the plan",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto doubler = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(2.0));
+    auto tripler = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(3.0));
+    auto last = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(10.0));
+    blockSystem->addBlock(doubler);
+    blockSystem->addBlock(tripler);
+    blockSystem->addBlock(last);
+    blocks::Connection connection;
+    connection.source.block = doubler;
+    connection.target.block = tripler;
+    blockSystem->addConnection(connection);
+    connection.source.block = tripler;
+    connection.target.block = last;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = doubler;
+    blockSystem->addInput(port);
+    port.block = last;
+    blockSystem->addOutput(port);
+    // Dry path summed into the last block
+    connection.source.block = doubler;
+    connection.gain = 0.5f;
+    blockSystem->addConnection(connection);
+    auto run = [&blockSystem](float x) {
+        std::vector<float> input(8, x), output(8);
+        const float* inputs[] = {input.data()};
+        float* outputs[] = {output.data()};
+        blockSystem->evaluateBuffer(inputs, outputs, 8);
+        return output.back();
+    };
+    REQUIRE(run(1.0f) == 70.0f);
+    blockSystem->setBypassed(tripler, true);
+    REQUIRE(blockSystem->getExecutionPlan()->steps.size() == 2);
+    REQUIRE(run(1.0f) == 30.0f);
+    // The output now sums both paths into the last block directly
+    blockSystem->setBypassed(last, true);
+    REQUIRE(blockSystem->getExecutionPlan()->steps.size() == 1);
+    REQUIRE(run(1.0f) == 3.0f);
+    blockSystem->setBypassed(tripler, false);
+    blockSystem->setBypassed(last, false);
+    REQUIRE(run(1.0f) == 70.0f);
+    REQUIRE_THROWS_AS(
+        blockSystem->setBypassed(std::make_shared<blocks::Splitter>(2), true),
+        blocks::invalid_operation_error);
+}
+
+TEST_CASE("Prepared systems run delays at the stream's sample rate",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto delay = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(0.001f));
+    blockSystem->addBlock(delay);
+    blocks::Port port;
+    port.block = delay;
+    blockSystem->addInput(port);
+    blockSystem->addOutput(port);
+    blocks::ProcessSpec spec;
+    spec.sampleRate = 96000.0;
+    spec.maxBlockSize = 16;
+    blockSystem->prepare(spec);
+    REQUIRE(delay->getTailLength() == 96);
+    // Larger buffers than prepared for are processed in chunks
+    std::vector<float> input(200, 0.0f), output(200);
+    input[3] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blockSystem->evaluateBuffer(inputs, outputs, 200);
+    for (uint i = 0; i < output.size(); ++i) {
+        REQUIRE(output[i] == (i == 99 ? 1.0f : 0.0f));
+    }
+    // Blocks added later follow the system's spec
+    auto late = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(0.001f));
+    blockSystem->addBlock(late);
+    REQUIRE(late->getTailLength() == 96);
+}
+
+namespace {
+
+// Emits the smallest subnormal float whenever its input is non-zero
+class SubnormalSource : public blocks::BlockAtomic {
+  public:
+    SubnormalSource() : BlockAtomic(1, 1) {}
+    void evaluate() override {
+        outputs_[0] = inputs_[0] != 0.0f
+                          ? std::numeric_limits<float>::denorm_min()
+                          : 0.0f;
+    }
+    std::shared_ptr<blocks::Block> clone() const override {
+        return std::make_shared<SubnormalSource>(*this);
+    }
+};
+
+} // namespace
+
+TEST_CASE("Subnormal outputs are counted per block and flushed",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto source = std::make_shared<SubnormalSource>();
+    auto gain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    blockSystem->addBlock(source);
+    blockSystem->addBlock(gain);
+    blocks::Connection connection;
+    connection.source.block = source;
+    connection.target.block = gain;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = source;
+    blockSystem->addInput(port);
+    port.block = gain;
+    blockSystem->addOutput(port);
+    std::vector<float> input(16, 1.0f), output(16, 1.0f);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blockSystem->evaluateBuffer(inputs, outputs, 16);
+    blockSystem->evaluateBuffer(inputs, outputs, 16);
+    REQUIRE(blockSystem->getDenormalCount(source) == 2);
+    REQUIRE(blockSystem->getDenormalCount(gain) == 0);
+    REQUIRE(std::all_of(output.cbegin(), output.cend(),
+                        [](float x) { return x == 0.0f; }));
+}
+
+TEST_CASE("Counters can be read while plans are switched in", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto source = std::make_shared<SubnormalSource>();
+    auto gain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    blockSystem->addBlock(source);
+    blockSystem->addBlock(gain);
+    blocks::Connection connection;
+    connection.source.block = source;
+    connection.target.block = gain;
+    blockSystem->addConnection(connection);
+    blockSystem->addInput(blocks::Port{source, 0});
+    blockSystem->addOutput(blocks::Port{gain, 0});
+    auto jobs = std::make_shared<blocks::JobSystem>();
+    blockSystem->setJobSystem(jobs);
+    std::vector<float> input(16, 1.0f), output(16);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    std::atomic<bool> done{false};
+    std::atomic<uint> highest{0};
+    std::thread reader([&] {
+        while (!done) {
+            uint count = blockSystem->getDenormalCount(source) +
+                         blockSystem->getQuarantineCount(gain);
+            highest = std::max(highest.load(), count);
+        }
+    });
+    // Each plan runs one buffer before the next replaces it
+    for (uint i = 0; i < 200; ++i) {
+        blockSystem->setBypassed(gain, i % 2 == 0);
+        jobs->waitUntilBuilt();
+        blockSystem->evaluateBuffer(inputs, outputs, 16);
+    }
+    done = true;
+    reader.join();
+    REQUIRE(highest <= 1);
+    REQUIRE(blockSystem->getDenormalCount(source) == 1);
+}
+
+TEST_CASE("Decaying feedback loops are flushed to exact silence",
+          "[blocks]") {
+    auto echo = makeEchoSystem();
+    std::vector<float> input(2000, 0.0f), output(2000);
+    input[0] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    echo->evaluateBuffer(inputs, outputs, 2000);
+    auto lastSound = std::find_if(output.crbegin(), output.crend(),
+                                  [](float x) { return x != 0.0f; });
+    REQUIRE(lastSound != output.crend());
+    // 0.5 per round trip reaches the flush threshold after ~67 echoes
+    REQUIRE(output.crend() - lastSound < 500);
+    REQUIRE(std::fabs(*lastSound) >= blocks::kFlushThreshold);
+}
+
+namespace {
+
+// Turns any sample above 0.5 into NaN; counts its resets
+class UnstableBlock : public blocks::BlockAtomic {
+  public:
+    UnstableBlock() : BlockAtomic(1, 1) {}
+    void evaluate() override {
+        outputs_[0] = inputs_[0] > 0.5f
+                          ? std::numeric_limits<float>::quiet_NaN()
+                          : inputs_[0];
+    }
+    void reset() override { ++resets; }
+    std::shared_ptr<blocks::Block> clone() const override {
+        return std::make_shared<UnstableBlock>(*this);
+    }
+    uint resets = 0;
+};
+
+} // namespace
+
+TEST_CASE("Blocks emitting NaN are muted and reset", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto unstable = std::make_shared<UnstableBlock>();
+    auto gain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(2.0));
+    blockSystem->addBlock(unstable);
+    blockSystem->addBlock(gain);
+    blocks::Connection connection;
+    connection.source.block = unstable;
+    connection.target.block = gain;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = unstable;
+    blockSystem->addInput(port);
+    port.block = gain;
+    blockSystem->addOutput(port);
+    std::vector<float> input(32, 0.25f), output(32);
+    input[7] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blockSystem->evaluateBuffer(inputs, outputs, 32);
+    REQUIRE(std::all_of(output.cbegin(), output.cend(),
+                        [](float x) { return x == 0.0f; }));
+    REQUIRE(unstable->resets == 1);
+    REQUIRE(blockSystem->getQuarantineCount(unstable) == 1);
+    REQUIRE(blockSystem->getQuarantineCount(gain) == 0);
+    // Clean buffers pass again
+    input[7] = 0.25f;
+    blockSystem->evaluateBuffer(inputs, outputs, 32);
+    REQUIRE(output[0] == 0.5f);
+    // Unguarded blocks pass non-finite values on to the next guarded one
+    unstable->setNonFiniteGuard(false);
+    input[7] = 1.0f;
+    blockSystem->evaluateBuffer(inputs, outputs, 32);
+    REQUIRE(blockSystem->getQuarantineCount(unstable) == 1);
+    REQUIRE(blockSystem->getQuarantineCount(gain) == 1);
+    gain->setNonFiniteGuard(false);
+    blockSystem->evaluateBuffer(inputs, outputs, 32);
+    REQUIRE(std::isnan(output[7]));
+}
+
+TEST_CASE("NaN entering a feedback loop does not circulate", "[blocks]") {
+    auto echo = makeEchoSystem();
+    std::vector<float> input(200, 0.0f), output(200);
+    input[0] = std::numeric_limits<float>::infinity();
+    input[100] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    echo->evaluateBuffer(inputs, outputs, 200);
+    REQUIRE(std::all_of(output.cbegin(), output.cend(),
+                        [](float x) { return std::isfinite(x); }));
+    auto firstEcho = std::find_if(output.cbegin(), output.cend(),
+                              [](float x) { return x != 0.0f; });
+    REQUIRE(firstEcho - output.cbegin() > 100);
+    REQUIRE(*firstEcho == 1.0f);
+}
+
+namespace {
+
+// Copies its input; records the fallback mode it was switched to
+class TieredBlock : public blocks::BlockAtomic {
+  public:
+    TieredBlock(float cost) : BlockAtomic(1, 1), cost_(cost) {}
+    void evaluate() override { outputs_[0] = inputs_[0]; }
+    float getCostEstimate() const override { return cost_; }
+    std::shared_ptr<blocks::Block> clone() const override {
+        return std::make_shared<TieredBlock>(*this);
+    }
+    uint mode = 0;
+
+  protected:
+    uint getFallbackCount() const override { return 2; }
+    void onQualityLevel(uint level) override { mode = level; }
+
+  private:
+    float cost_;
+};
+
+} // namespace
+
+TEST_CASE("Load governor trades quality for time and restores it",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto heavy = std::make_shared<TieredBlock>(4.0f);
+    auto light = std::make_shared<TieredBlock>(1.0f);
+    auto gain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(0.5f));
+    gain->setBypassUnderLoad(true);
+    blockSystem->addBlock(light);
+    blockSystem->addBlock(gain);
+    blockSystem->addBlock(heavy);
+    blocks::Connection connection;
+    connection.source.block = heavy;
+    connection.target.block = light;
+    blockSystem->addConnection(connection);
+    connection.source.block = light;
+    connection.target.block = gain;
+    blockSystem->addConnection(connection);
+    blockSystem->addInput(blocks::Port{heavy, 0});
+    blockSystem->addOutput(blocks::Port{gain, 0});
+
+    blocks::LoadPolicy policy;
+    policy.restoreAfter = 2;
+    policy.settleBuffers = 0;
+    policy.smoothing = 1.0f;
+    blocks::LoadGovernor governor(blockSystem, policy);
+    REQUIRE(governor.getMaxDegradation() == 5);
+    constexpr uint nFrames = 64;
+    const double deadline = nFrames / blocks::kDefaultSampleRate;
+
+    std::vector<uint> heavyModes, lightModes;
+    for (uint i = 0; i < 6; ++i) {
+        governor.update(0.95 * deadline, nFrames);
+        heavyModes.push_back(heavy->mode);
+        lightModes.push_back(light->mode);
+    }
+    REQUIRE_THAT(governor.getLoad(),
+                 Catch::Matchers::WithinAbs(0.95f, 1e-4f));
+    REQUIRE(governor.getDegradation() == 5);
+    REQUIRE(heavyModes == std::vector<uint>{1, 1, 2, 2, 2, 2});
+    REQUIRE(lightModes == std::vector<uint>{0, 1, 1, 2, 2, 2});
+    REQUIRE(gain->isSuspended());
+
+    std::vector<float> input(nFrames, 1.0f), output(nFrames);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blockSystem->evaluateBuffer(inputs, outputs, nFrames);
+    REQUIRE(output == input);
+
+    // Loads between the thresholds neither degrade nor restore
+    governor.update(0.7 * deadline, nFrames);
+    governor.update(0.2 * deadline, nFrames);
+    governor.update(0.7 * deadline, nFrames);
+    governor.update(0.2 * deadline, nFrames);
+    REQUIRE(governor.getDegradation() == 5);
+    governor.update(0.2 * deadline, nFrames);
+    REQUIRE(governor.getDegradation() == 4);
+    REQUIRE_FALSE(gain->isSuspended());
+    blockSystem->evaluateBuffer(inputs, outputs, nFrames);
+    REQUIRE(output == std::vector<float>(nFrames, 0.5f));
+    for (uint i = 0; i < 8; ++i) {
+        governor.update(0.2 * deadline, nFrames);
+    }
+    REQUIRE(governor.getDegradation() == 0);
+    REQUIRE(heavy->mode == 0);
+    REQUIRE(light->mode == 0);
+}
+
+TEST_CASE("Load governor passes over bypassed blocks", "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto heavy = std::make_shared<TieredBlock>(4.0f);
+    auto light = std::make_shared<TieredBlock>(1.0f);
+    blockSystem->addBlock(heavy);
+    blockSystem->addBlock(light);
+    blocks::Connection connection;
+    connection.source.block = heavy;
+    connection.target.block = light;
+    blockSystem->addConnection(connection);
+    blockSystem->addInput(blocks::Port{heavy, 0});
+    blockSystem->addOutput(blocks::Port{light, 0});
+    blocks::LoadPolicy policy;
+    policy.restoreAfter = 1;
+    policy.settleBuffers = 4;
+    policy.smoothing = 1.0f;
+    blocks::LoadGovernor governor(blockSystem, policy);
+    REQUIRE(governor.getMaxDegradation() == 4);
+    constexpr uint nFrames = 64;
+    const double deadline = nFrames / blocks::kDefaultSampleRate;
+
+    // The heavy block's rungs come first but would save nothing
+    blockSystem->setBypassed(heavy, true);
+    governor.update(0.95 * deadline, nFrames);
+    REQUIRE(governor.getDegradation() == 2);
+    REQUIRE(light->mode == 1);
+    for (uint i = 0; i < 4; ++i) {
+        governor.update(0.95 * deadline, nFrames);
+    }
+    REQUIRE(governor.getDegradation() == 4);
+    REQUIRE(light->mode == 2);
+    governor.update(0.2 * deadline, nFrames);
+    REQUIRE(governor.getDegradation() == 2);
+    REQUIRE(light->mode == 1);
+    governor.update(0.2 * deadline, nFrames);
+    REQUIRE(governor.getDegradation() == 0);
+    REQUIRE(light->mode == 0);
+    REQUIRE(heavy->mode == 0);
+}
+
+TEST_CASE("Oversamplers, reverbs and convolutions shed cost under load",
+          "[blocks]") {
+    std::vector<float> input(3000);
+    for (size_t n = 0; n < input.size(); ++n) {
+        input[n] = float(std::sin(0.03 * double(n))) * (n < 1500);
+    }
+    auto run = [&input](blocks::Process& process) {
+        std::vector<float> output(input.size());
+        process.processBuffer(input.data(), output.data(), input.size());
+        return output;
+    };
+    auto maxDifference = [](const std::vector<float>& a,
+                            const std::vector<float>& b) {
+        float difference = 0.0f;
+        for (size_t n = 0; n < a.size(); ++n) {
+            difference = std::max(difference, std::fabs(a[n] - b[n]));
+        }
+        return difference;
+    };
+
+    // Eight lines down to four behave like the first four alone
+    const std::vector<float> times = {0.003f, 0.0037f, 0.0041f, 0.0043f,
+                                      0.0053f, 0.0059f, 0.0067f, 0.0073f};
+    blocks::FdnReverb reverb(0.2f, times, 0.2f);
+    blocks::FdnReverb fourLines(
+        0.2f, std::vector<float>(times.begin(), times.begin() + 4), 0.2f);
+    REQUIRE(reverb.getFallbackCount() == 2);
+    reverb.setQualityLevel(1);
+    REQUIRE(maxDifference(run(reverb), run(fourLines)) < 1e-6f);
+    // Lines coming back restart silent
+    reverb.setQualityLevel(0);
+    reverb.reset();
+    blocks::FdnReverb fresh(0.2f, times, 0.2f);
+    REQUIRE(maxDifference(run(reverb), run(fresh)) == 0.0f);
+
+    // The response is cut to the body, then to the head
+    std::vector<float> response(5000);
+    for (size_t k = 0; k < response.size(); ++k) {
+        response[k] = std::exp(-float(k) / 1000.0f) * (k % 5 == 0);
+    }
+    auto truncated = [&response](size_t length) {
+        return std::vector<float>(response.begin(),
+                                  response.begin() + length);
+    };
+    blocks::Convolution convolution(response, false);
+    REQUIRE(convolution.getFallbackCount() == 2);
+    convolution.setQualityLevel(1);
+    blocks::Convolution body(truncated(2 * blocks::Convolution::kTailBlock),
+                             false);
+    REQUIRE(maxDifference(run(convolution), run(body)) < 1e-5f);
+    convolution.setQualityLevel(2);
+    blocks::Convolution head(truncated(blocks::Convolution::kHeadLength),
+                             false);
+    REQUIRE(maxDifference(run(convolution), run(head)) < 1e-5f);
+    convolution.setQualityLevel(0);
+    convolution.reset();
+    blocks::Convolution full(response, false);
+    REQUIRE(maxDifference(run(convolution), run(full)) < 1e-5f);
+
+    // Factor 8 at level 2 filters like factor 2
+    auto shaper = [] {
+        return std::make_shared<blocks::ProcessBlock>(
+            std::make_unique<blocks::Gain>(0.5f));
+    };
+    blocks::Oversampler eight(shaper(), 8);
+    blocks::Oversampler two(shaper(), 2);
+    REQUIRE(eight.getQualityLevelCount() == 3);
+    eight.setQualityLevel(2);
+    REQUIRE(eight.getLatency() == two.getLatency());
+    std::vector<float> eightOutput(input.size()), twoOutput(input.size());
+    const float* inputs[] = {input.data()};
+    float* eightOutputs[] = {eightOutput.data()};
+    float* twoOutputs[] = {twoOutput.data()};
+    eight.evaluateBuffer(inputs, eightOutputs, uint(input.size()));
+    two.evaluateBuffer(inputs, twoOutputs, uint(input.size()));
+    REQUIRE(eightOutput == twoOutput);
+
+    // The governor's ladder takes every fallback
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    blockSystem->addBlock(std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::FdnReverb>(1.0f)));
+    blockSystem->addBlock(std::make_shared<blocks::Oversampler>(shaper(), 4));
+    blocks::LoadGovernor governor(blockSystem);
+    REQUIRE(governor.getMaxDegradation() == 3);
+}
+
+TEST_CASE("Realtime allocator reuses chunks and reports exhaustion",
+          "[blocks]") {
+    blocks::RealtimeAllocator allocator(
+        blocks::RealtimeAllocator::getChunkSize(100) +
+        blocks::RealtimeAllocator::getChunkSize(1));
+    REQUIRE(blocks::RealtimeAllocator::getChunkSize(100) >= 100);
+    void* large = allocator.allocate(100);
+    void* small = allocator.allocate(1);
+    REQUIRE(large != nullptr);
+    REQUIRE(small != nullptr);
+    REQUIRE(reinterpret_cast<uintptr_t>(large) %
+                blocks::RealtimeAllocator::kAlignment ==
+            0);
+    REQUIRE(allocator.allocate(1) == nullptr);
+    REQUIRE(allocator.getUsed() == allocator.getCapacity());
+
+    allocator.deallocate(large);
+    void* again = allocator.allocate(90);
+    REQUIRE(again == large);
+    // Freed chunks are split for smaller requests
+    allocator.deallocate(again);
+    const size_t piece = blocks::RealtimeAllocator::getChunkSize(20);
+    void* first = allocator.allocate(20);
+    void* second = allocator.allocate(20);
+    REQUIRE(first == large);
+    REQUIRE(second == static_cast<unsigned char*>(large) + piece);
+    REQUIRE(allocator.getUsed() ==
+            2 * piece + blocks::RealtimeAllocator::getChunkSize(1));
+    // and their pieces merge again once freed, in any order
+    allocator.deallocate(first);
+    allocator.deallocate(second);
+    REQUIRE(allocator.allocate(100) == large);
+    REQUIRE(allocator.getUsed() == allocator.getCapacity());
+    // Chunks bordering the untouched rest go back to it
+    allocator.deallocate(small);
+    allocator.deallocate(large);
+    REQUIRE(allocator.getUsed() == 0);
+    REQUIRE(allocator.allocate(140) == large);
+}
+
+TEST_CASE("Realtime allocator merges everything freed back together",
+          "[blocks]") {
+    using blocks::RealtimeAllocator;
+    RealtimeAllocator allocator(1 << 16);
+    // Each live chunk is filled with its own tag, checked when freed
+    std::vector<std::pair<unsigned char*, size_t>> live;
+    uint32_t state = 7;
+    auto next = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    auto release = [&](size_t index) {
+        auto [data, size] = live[index];
+        const auto tag = static_cast<unsigned char>(size);
+        REQUIRE(std::all_of(data, data + size,
+                            [tag](unsigned char x) { return x == tag; }));
+        allocator.deallocate(data);
+        live[index] = live.back();
+        live.pop_back();
+    };
+    for (uint i = 0; i < 5000; ++i) {
+        if (live.empty() || next() % 3 != 0) {
+            const size_t size = 1 + next() % 3000;
+            auto* data = static_cast<unsigned char*>(allocator.allocate(size));
+            if (data != nullptr) {
+                std::fill_n(data, size, static_cast<unsigned char>(size));
+                live.emplace_back(data, size);
+            }
+        } else {
+            release(next() % live.size());
+        }
+    }
+    while (!live.empty()) {
+        release(live.size() - 1);
+    }
+    REQUIRE(allocator.getUsed() == 0);
+    REQUIRE(allocator.allocate(allocator.getCapacity() -
+                               RealtimeAllocator::kAlignment) != nullptr);
+}
+
+TEST_CASE("Realtime allocator places chunks without power-of-two slack",
+          "[blocks]") {
+    using blocks::RealtimeAllocator;
+    const size_t header = RealtimeAllocator::kAlignment;
+    REQUIRE(RealtimeAllocator::getChunkSize(4096) == 4096 + header);
+    REQUIRE(RealtimeAllocator::getChunkSize(4097) ==
+            4096 + header + RealtimeAllocator::kAlignment);
+    RealtimeAllocator allocator(3 * RealtimeAllocator::getChunkSize(5000));
+    std::vector<void*> chunks;
+    for (int i = 0; i < 3; ++i) {
+        chunks.push_back(allocator.allocate(5000));
+        REQUIRE(chunks.back() != nullptr);
+    }
+    REQUIRE(allocator.allocate(1) == nullptr);
+    allocator.deallocate(chunks[1]);
+    REQUIRE(allocator.allocate(5000 + header) == nullptr);
+    REQUIRE(allocator.allocate(4990) == chunks[1]);
+}
+
+namespace {
+
+// Delay whose length changes while processing, drawing its line from the pool
+class PooledDelay : public blocks::BlockAtomic {
+  public:
+    static constexpr uint kMaxLength = 64;
+    PooledDelay() : BlockAtomic(1, 1) {}
+    void evaluate() override {}
+    void prepare(const blocks::ProcessSpec& spec) override {
+        allocator_ = spec.allocator;
+        setParameter(0, 1.0f);
+    }
+    size_t getRealtimeMemory(const blocks::ProcessSpec&) const override {
+        // The old line is released only once the new one is in place
+        return 2 * blocks::RealtimeAllocator::getChunkSize(kMaxLength *
+                                                           sizeof(float));
+    }
+    void setParameter(uint, float value) override {
+        if (allocator_ == nullptr) {
+            return;
+        }
+        blocks::PooledArray<float> line(allocator_, uint(value));
+        std::fill_n(line.data(), line.size(), 0.0f);
+        line_ = std::move(line);
+        position_ = 0;
+    }
+    void evaluateBuffer(blocks::InputBuffers_t inputs,
+                        blocks::OutputBuffers_t outputs,
+                        uint nFrames) override {
+        for (uint i = 0; i < nFrames; ++i) {
+            outputs[0][i] = line_[position_];
+            line_[position_] = inputs[0][i];
+            position_ = (position_ + 1) % line_.size();
+        }
+    }
+    std::shared_ptr<blocks::Block> clone() const override {
+        auto copy = std::make_shared<PooledDelay>();
+        copy->allocator_ = allocator_;
+        return copy;
+    }
+    size_t getLength() const { return line_.size(); }
+
+  private:
+    std::shared_ptr<blocks::RealtimeAllocator> allocator_;
+    blocks::PooledArray<float> line_;
+    size_t position_ = 0;
+};
+
+} // namespace
+
+TEST_CASE("Blocks resize state from their system's pool while processing",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto delay = std::make_shared<PooledDelay>();
+    blockSystem->addBlock(delay);
+    blockSystem->addInput(blocks::Port{delay, 0});
+    blockSystem->addOutput(blocks::Port{delay, 0});
+    REQUIRE(delay->getLength() == 0);
+    blockSystem->prepare(blocks::ProcessSpec{});
+    REQUIRE(delay->getLength() == 1);
+
+    std::vector<float> input(8), output(8);
+    std::iota(input.begin(), input.end(), 1.0f);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    for (uint length : {PooledDelay::kMaxLength, 3u, 40u, 3u}) {
+        blockSystem->evaluateBuffer(inputs, outputs, 8,
+                                    {{0, delay, 0, float(length)}});
+        REQUIRE(delay->getLength() == length);
+    }
+    REQUIRE(output == std::vector<float>{0, 0, 0, 1, 2, 3, 4, 5});
+}
+
+TEST_CASE("Job commits run on dispatch and are freed on a worker",
+          "[blocks]") {
+    blocks::JobSystem jobs(2);
+    const auto mainThread = std::this_thread::get_id();
+    std::atomic<bool> freedOnWorker{false};
+    std::weak_ptr<int> released;
+    int value = 0;
+    jobs.submit([&]() -> blocks::JobSystem::Commit_t {
+        auto result = std::shared_ptr<int>(new int(42), [&](int* p) {
+            freedOnWorker = std::this_thread::get_id() != mainThread;
+            delete p;
+        });
+        released = result;
+        return [&value, result] { value = *result; };
+    });
+    jobs.waitUntilBuilt();
+    REQUIRE(value == 0);
+    REQUIRE(jobs.dispatch() == 1);
+    REQUIRE(value == 42);
+    REQUIRE(jobs.dispatch() == 0);
+    for (uint i = 0; i < 200 && !released.expired(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(released.expired());
+    REQUIRE(freedOnWorker);
+}
+
+TEST_CASE("Delay lines grow in the background while processing",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto delay = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(4.0f / blocks::kDefaultSampleRate));
+    blockSystem->addBlock(delay);
+    blockSystem->addInput(blocks::Port{delay, 0});
+    blockSystem->addOutput(blocks::Port{delay, 0});
+    auto jobs = std::make_shared<blocks::JobSystem>();
+    blockSystem->setJobSystem(jobs);
+
+    std::vector<float> input(32, 0.0f), output(32);
+    input[0] = 1.0f;
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    // Clamped to the current line until the larger one is switched in
+    blockSystem->evaluateBuffer(inputs, outputs, 32,
+                                {{0, delay, 0, 20.0f / 44100.0f}});
+    REQUIRE(output[4] == 1.0f);
+
+    blockSystem->setParameterAsync(delay, 1, 20.0f / 44100.0f);
+    jobs->waitUntilBuilt();
+    input[0] = 0.0f;
+    blockSystem->evaluateBuffer(inputs, outputs, 32);
+    REQUIRE(delay->getTailLength() == 4);
+    input[0] = 1.0f;
+    blockSystem->evaluateBuffer(inputs, outputs, 32,
+                                {{0, delay, 0, 20.0f / 44100.0f}});
+    REQUIRE(output[20] == 1.0f);
+    REQUIRE(std::count(output.cbegin(), output.cend(), 0.0f) == 31);
+}
+
+TEST_CASE("Delay lines switched while streaming come from the pool",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto delay = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Delay>(0.001f, 0.01f));
+    blockSystem->addBlock(delay);
+    blockSystem->addInput(blocks::Port{delay, 0});
+    blockSystem->addOutput(blocks::Port{delay, 0});
+    auto jobs = std::make_shared<blocks::JobSystem>();
+    blockSystem->setJobSystem(jobs);
+    blocks::ProcessSpec spec;
+    spec.sampleRate = 48000.0;
+    blockSystem->prepare(spec);
+    const auto pool = blockSystem->getProcessSpec().allocator;
+    const size_t used = pool->getUsed();
+    REQUIRE(used == pool->getCapacity());
+
+    std::vector<float> input(64, 0.0f), output(64);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    // A shorter line takes part of the chunk the old one gave back
+    blockSystem->setParameterAsync(delay, 1, 0.005f);
+    jobs->waitUntilBuilt();
+    blockSystem->evaluateBuffer(inputs, outputs, 64);
+    REQUIRE(delay->getMemoryUsage() == (512 + 256) * sizeof(float));
+    REQUIRE(pool->getUsed() == blocks::RealtimeAllocator::getChunkSize(
+                                   (512 + 256) * sizeof(float)));
+    // and the longer one fits there again
+    blockSystem->setParameterAsync(delay, 1, 0.01f);
+    jobs->waitUntilBuilt();
+    blockSystem->evaluateBuffer(inputs, outputs, 64);
+    REQUIRE(pool->getUsed() == used);
+    // A longer one than the pool holds lives on the heap instead
+    blockSystem->setParameterAsync(delay, 1, 0.1f);
+    jobs->waitUntilBuilt();
+    blockSystem->evaluateBuffer(inputs, outputs, 64);
+    REQUIRE(delay->getMemoryUsage() == (8192 + 256) * sizeof(float));
+    REQUIRE(pool->getUsed() == 0);
+
+    input[0] = 1.0f;
+    blockSystem->evaluateBuffer(inputs, outputs, 64);
+    REQUIRE(output[48] == 1.0f);
+    REQUIRE(std::count(output.cbegin(), output.cend(), 0.0f) == 63);
+}
+
+TEST_CASE("Bypassing with a job system recompiles off the audio thread",
+          "[blocks]") {
+    auto blockSystem = makeEchoSystem();
+    auto jobs = std::make_shared<blocks::JobSystem>();
+    blockSystem->setJobSystem(jobs);
+    auto plan = blockSystem->getExecutionPlan();
+    auto feedback = blockSystem->viewBlocks()[3];
+    blockSystem->setBypassed(feedback, true);
+    // The current plan keeps running until the new one is switched in
+    REQUIRE(blockSystem->getExecutionPlan() == plan);
+    jobs->waitUntilBuilt();
+    std::vector<float> input(16, 0.0f), output(16);
+    const float* inputs[] = {input.data()};
+    float* outputs[] = {output.data()};
+    blockSystem->evaluateBuffer(inputs, outputs, 16);
+    REQUIRE(blockSystem->getExecutionPlan() != plan);
+    REQUIRE(blockSystem->getExecutionPlan()->steps.size() ==
+            plan->steps.size() - 1);
+}
+
+TEST_CASE("Shift register spans match per-sample reads across the wrap",
+          "[blocks]") {
+    blocks::ShiftRegister<float> bulk(37, 8);
+    blocks::ShiftRegister<float> single(37);
+    float next = 1.0f;
+    for (size_t n : {3, 8, 1, 8, 7, 8, 8, 5, 8, 2, 8, 8, 8, 6}) {
+        std::vector<float> samples(n);
+        for (auto& sample : samples) {
+            sample = next++;
+            single.push(sample);
+        }
+        bulk.write(samples.data(), n);
+        for (size_t index = 0; index < 37; ++index) {
+            REQUIRE(bulk.at(index) == single.at(index));
+        }
+        for (size_t index = 0; index + 8 <= 37; index += 3) {
+            const float* span = bulk.span(index, 8);
+            for (size_t i = 0; i < 8; ++i) {
+                REQUIRE(span[i] == single.at(index + 7 - i));
+            }
+        }
+    }
+    bulk.push(next);
+    single.push(next);
+    REQUIRE(bulk.span(0, 8)[7] == next);
+    REQUIRE(bulk.span(1, 8)[0] == single.at(8));
+}
+
+TEST_CASE("Delay buffers of any length match per-sample processing",
+          "[blocks]") {
+    for (float samples : {0.0f, 1.0f, 100.0f, 300.0f}) {
+        blocks::Delay perSample(samples / blocks::kDefaultSampleRate);
+        blocks::Delay buffered(samples / blocks::kDefaultSampleRate);
+        std::vector<float> input(1500), expected(1500), output(1500);
+        std::iota(input.begin(), input.end(), 1.0f);
+        for (size_t i = 0; i < input.size(); ++i) {
+            expected[i] = perSample.process(input[i]);
+        }
+        size_t done = 0;
+        for (size_t n : {1, 700, 13, 256, 530}) {
+            buffered.processBuffer(input.data() + done, output.data() + done,
+                                   n);
+            done += n;
+        }
+        REQUIRE(output == expected);
+        // In place
+        blocks::Delay inPlace(samples / blocks::kDefaultSampleRate);
+        inPlace.processBuffer(input.data(), input.data(), input.size());
+        REQUIRE(input == expected);
+    }
+}
+
+TEST_CASE("Delay lines are right-sized and drawn from the graph's pool",
+          "[blocks]") {
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    std::vector<std::shared_ptr<blocks::Block>> delays;
+    for (uint i = 0; i < 100; ++i) {
+        delays.emplace_back(std::make_shared<blocks::ProcessBlock>(
+            std::make_unique<blocks::Delay>(0.01f)));
+        blockSystem->addBlock(delays.back());
+    }
+    blocks::ProcessSpec spec;
+    spec.sampleRate = 48000.0;
+    blockSystem->prepare(spec);
+    // 480 samples plus the bulk-copy span, rounded to a power of two
+    size_t perDelay = (1024 + 256) * sizeof(float);
+    REQUIRE(delays.front()->getMemoryUsage() == perDelay);
+    REQUIRE(blockSystem->getMemoryUsage() == 100 * perDelay);
+    const auto& pool = blockSystem->getProcessSpec().allocator;
+    REQUIRE(pool != nullptr);
+    REQUIRE(pool->getUsed() == blockSystem->getRealtimeMemory(spec));
+    REQUIRE(pool->getUsed() == pool->getCapacity());
+    // Each line takes its storage and one header, not a doubled chunk
+    REQUIRE(pool->getCapacity() ==
+            100 * (perDelay + blocks::RealtimeAllocator::kAlignment));
+
+    // Clones copy their lines onto the heap, and get a pool of their own
+    // once prepared
+    auto copy = std::static_pointer_cast<blocks::BlockSystem>(
+        blockSystem->clone());
+    REQUIRE(copy->getMemoryUsage() == 100 * perDelay);
+    REQUIRE(copy->getProcessSpec().allocator == nullptr);
+    copy->prepare(spec);
+    const auto& copyPool = copy->getProcessSpec().allocator;
+    REQUIRE(copyPool != nullptr);
+    REQUIRE(copyPool != pool);
+    REQUIRE(copyPool->getUsed() == copyPool->getCapacity());
+}
+
+TEST_CASE("Half-precision samples round trip within their precision",
+          "[blocks]") {
+    using blocks::bFloat16ToFloat;
+    using blocks::floatToBFloat16;
+    using blocks::floatToHalf;
+    using blocks::halfToFloat;
+    // Every finite half converts to float and back unchanged
+    uint mismatches = 0;
+    for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+        if ((bits & 0x7c00) != 0x7c00 &&
+            floatToHalf(halfToFloat(uint16_t(bits))) != bits) {
+            ++mismatches;
+        }
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(halfToFloat(floatToHalf(1.0f)) == 1.0f);
+    REQUIRE(halfToFloat(floatToHalf(-0.5f)) == -0.5f);
+    REQUIRE(halfToFloat(0x0001) == std::ldexp(1.0f, -24));
+    REQUIRE(halfToFloat(floatToHalf(65504.0f)) == 65504.0f);
+    REQUIRE(std::isinf(halfToFloat(floatToHalf(1e6f))));
+    REQUIRE(std::isnan(
+        halfToFloat(floatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+    // Ties round to even
+    REQUIRE(floatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+    REQUIRE(floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3c02);
+
+    REQUIRE_THAT(bFloat16ToFloat(floatToBFloat16(1e30f)),
+                 Catch::Matchers::WithinRel(1e30f, 1.0f / 256));
+    REQUIRE(std::isnan(bFloat16ToFloat(
+        floatToBFloat16(std::numeric_limits<float>::quiet_NaN()))));
+    for (float x = -2.0f; x < 2.0f; x += 0.0137f) {
+        float half = halfToFloat(floatToHalf(x));
+        float brain = bFloat16ToFloat(floatToBFloat16(x));
+        REQUIRE(std::fabs(half - x) <=
+                std::max(std::fabs(x) * std::ldexp(1.0f, -11),
+                         std::ldexp(1.0f, -25)));
+        REQUIRE(std::fabs(brain - x) <= std::fabs(x) * std::ldexp(1.0f, -8));
+    }
+}
+
+TEST_CASE("Float16 block conversions match with and without F16C",
+          "[blocks]") {
+    // Every non-NaN half, then floats with random bits across the range
+    std::vector<uint16_t> halves;
+    for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+        if ((bits & 0x7c00) != 0x7c00 || (bits & 0x03ff) == 0) {
+            halves.push_back(uint16_t(bits));
+        }
+    }
+    std::vector<float> floats;
+    uint32_t state = 12345;
+    while (floats.size() < 100003) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        float x;
+        std::memcpy(&x, &state, sizeof(x));
+        if (!std::isnan(x)) {
+            floats.push_back(x);
+        }
+    }
+    const auto storage = blocks::SampleStorage::Float16;
+    const blocks::CpuFeatures detected = blocks::detectCpuFeatures();
+    std::vector<std::vector<float>> decoded;
+    std::vector<std::vector<uint16_t>> encoded;
+    for (bool f16c : {false, true}) {
+        blocks::CpuFeatures features = detected;
+        features.f16c = f16c && detected.f16c;
+        blocks::setCpuFeatures(features);
+        decoded.emplace_back(halves.size());
+        blocks::decodeSamples(storage, halves.data(), decoded.back().data(),
+                              halves.size());
+        encoded.emplace_back(floats.size());
+        blocks::encodeSamples(storage, floats.data(), encoded.back().data(),
+                              floats.size());
+    }
+    blocks::setCpuFeatures(detected);
+    REQUIRE(std::memcmp(decoded[0].data(), decoded[1].data(),
+                        halves.size() * sizeof(float)) == 0);
+    REQUIRE(encoded[0] == encoded[1]);
+}
+
+TEST_CASE("Shift register gathers match with and without AVX2",
+          "[blocks]") {
+    blocks::ShiftRegister<float> line(1000, 64);
+    std::vector<float> samples(64);
+    float next = 0.0f;
+    // Past the wrap, so slots come from both ends of the ring
+    for (int block = 0; block < 40; ++block) {
+        for (float& sample : samples) {
+            sample = next++;
+        }
+        line.write(samples.data(), samples.size());
+    }
+    std::vector<uint32_t> index(1061);
+    uint32_t state = 777;
+    for (auto& i : index) {
+        state = state * 1664525u + 1013904223u;
+        i = (state >> 8) % (1000 + 64 - 1);
+    }
+    const blocks::CpuFeatures detected = blocks::detectCpuFeatures();
+    std::vector<std::vector<float>> gathered;
+    for (bool avx2 : {false, true}) {
+        blocks::CpuFeatures features = detected;
+        features.avx2 = avx2 && detected.avx2;
+        blocks::setCpuFeatures(features);
+        gathered.emplace_back(index.size());
+        line.gather(index.data(), gathered.back().data(), index.size());
+    }
+    blocks::setCpuFeatures(detected);
+    uint mismatches = 0;
+    for (size_t i = 0; i < index.size(); ++i) {
+        mismatches += gathered[0][i] != next - 1.0f - float(index[i]);
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(gathered[0] == gathered[1]);
+}
+
+TEST_CASE("Compressed delay lines halve memory and track float delays",
+          "[blocks]") {
+    using blocks::SampleStorage;
+    for (auto storage : {SampleStorage::Float16, SampleStorage::BFloat16}) {
+        const float time = 300.0f / blocks::kDefaultSampleRate;
+        blocks::Delay exact(time);
+        blocks::Delay compressed(time, 0.0f, storage);
+        REQUIRE(compressed.getMemoryUsage() * 2 == exact.getMemoryUsage());
+        float tolerance = storage == SampleStorage::Float16
+                              ? std::ldexp(1.0f, -11)
+                              : std::ldexp(1.0f, -8);
+        std::vector<float> input(1000), expected(1000), output(1000);
+        for (size_t i = 0; i < input.size(); ++i) {
+            input[i] = std::sin(0.01f * float(i));
+        }
+        exact.processBuffer(input.data(), expected.data(), input.size());
+        compressed.processBuffer(input.data(), output.data(), 700);
+        for (size_t i = 700; i < input.size(); ++i) {
+            output[i] = compressed.process(input[i]);
+        }
+        for (size_t i = 0; i < input.size(); ++i) {
+            REQUIRE(std::fabs(output[i] - expected[i]) <=
+                    std::fabs(expected[i]) * tolerance + 1e-7f);
+        }
+    }
+}
+
+TEST_CASE("Multi-tap delays read every tap from one line", "[blocks]") {
+    const float sample = 1.0f / float(blocks::kDefaultSampleRate);
+    blocks::MultiTapDelay buffered({{3 * sample, 1.0f}, {300 * sample, 0.5f}});
+    blocks::MultiTapDelay perSample({{3 * sample, 1.0f}, {300 * sample, 0.5f}});
+    REQUIRE(buffered.getOutputSize() == 3);
+    REQUIRE(buffered.getTailLength() == 300);
+    blocks::Delay single(300 * sample);
+    REQUIRE(buffered.getMemoryUsage() == single.getMemoryUsage());
+
+    std::vector<float> input(700, 0.0f);
+    input[0] = 1.0f;
+    input[400] = 2.0f;
+    std::vector<float> sum(700), first(700), second(700);
+    float* outputs[] = {sum.data(), first.data(), second.data()};
+    for (uint done = 0; done < 700; done += 350) {
+        const float* inputs[] = {input.data() + done};
+        float* chunk[] = {outputs[0] + done, outputs[1] + done,
+                          outputs[2] + done};
+        buffered.evaluateBuffer(inputs, chunk, 350);
+    }
+    uint mismatches = 0;
+    for (uint i = 0; i < input.size(); ++i) {
+        perSample.setInput(input[i]);
+        perSample.evaluate();
+        mismatches += perSample.getOutput(0) != sum[i] ||
+                      perSample.getOutput(1) != first[i] ||
+                      perSample.getOutput(2) != second[i] ||
+                      sum[i] != first[i] + second[i];
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(first[3] == 1.0f);
+    REQUIRE(first[403] == 2.0f);
+    REQUIRE(second[300] == 0.5f);
+    REQUIRE(std::count(sum.cbegin(), sum.cend(), 0.0f) == 700 - 3);
+
+    // Tap times are clamped to the longest initial tap
+    buffered.setParameter(0, 1.0f);
+    buffered.setParameter(3, 0.25f);
+    REQUIRE(buffered.getTailLength() == 300);
+    REQUIRE_THROWS_AS(buffered.setParameter(4, 0.0f),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("Modulated delays interpolate between samples", "[blocks]") {
+    using blocks::Interpolation;
+    const float rate = float(blocks::kDefaultSampleRate);
+    const Interpolation modes[] = {Interpolation::Linear,
+                                   Interpolation::Hermite,
+                                   Interpolation::Allpass};
+    std::vector<float> input(1000), modulation(1000);
+    for (uint i = 0; i < input.size(); ++i) {
+        input[i] = std::sin(0.05f * float(i)) + 0.25f * std::sin(0.31f * i);
+        modulation[i] = 4.0f * std::sin(0.003f * float(i)) / rate;
+    }
+
+    for (auto mode : modes) {
+        // Whole delays reproduce a plain delay exactly
+        blocks::ModulatedDelay whole(7 / rate, 20 / rate, mode);
+        blocks::Delay reference(7 / rate);
+        uint mismatches = 0;
+        for (float x : input) {
+            whole.setInput(x, 0);
+            whole.setInput(0.0f, 1);
+            whole.evaluate();
+            mismatches += whole.getOutput(0) != reference.process(x);
+        }
+        REQUIRE(mismatches == 0);
+
+        // Modulated, buffers in place match frame by frame evaluation
+        blocks::ModulatedDelay buffered(10 / rate, 20 / rate, mode);
+        blocks::ModulatedDelay perSample(10 / rate, 20 / rate, mode);
+        std::vector<float> output = input;
+        for (uint done = 0; done < output.size();) {
+            uint n = std::min<uint>(300, uint(output.size()) - done);
+            const float* inputs[] = {output.data() + done,
+                                     modulation.data() + done};
+            float* outputs[] = {output.data() + done};
+            buffered.evaluateBuffer(inputs, outputs, n);
+            done += n;
+        }
+        for (uint i = 0; i < input.size(); ++i) {
+            perSample.setInput(input[i], 0);
+            perSample.setInput(modulation[i], 1);
+            perSample.evaluate();
+            mismatches += perSample.getOutput(0) != output[i];
+        }
+        REQUIRE(mismatches == 0);
+    }
+
+    // Linear and Hermite reproduce a ramp at any fraction
+    for (auto mode : {Interpolation::Linear, Interpolation::Hermite}) {
+        blocks::ModulatedDelay ramp(2.25f / rate, 4 / rate, mode);
+        ramp.setInput(0.0f, 1);
+        for (uint i = 0; i < 10; ++i) {
+            ramp.setInput(float(i), 0);
+            ramp.evaluate();
+        }
+        REQUIRE_THAT(ramp.getOutput(0),
+                     Catch::Matchers::WithinAbs(9.0f - 2.25f, 1e-4f));
+        ramp.setInput(10.0f, 0);
+        ramp.setInput(0.5f / rate, 1);
+        ramp.evaluate();
+        REQUIRE_THAT(ramp.getOutput(0),
+                     Catch::Matchers::WithinAbs(10.0f - 2.75f, 1e-4f));
+    }
+
+    // Delays are clamped to what the line holds
+    blocks::ModulatedDelay clamped(5 / rate, 5 / rate, Interpolation::Hermite);
+    REQUIRE(clamped.getTailLength() == 6);
+    clamped.setInput(1.0f, 0);
+    clamped.setInput(100.0f, 1);
+    clamped.evaluate();
+    clamped.setInput(0.0f, 0);
+    for (uint i = 0; i < 5; ++i) {
+        clamped.evaluate();
+    }
+    REQUIRE_THAT(clamped.getOutput(0), Catch::Matchers::WithinAbs(1.0f, 1e-4f));
+    REQUIRE_THROWS_AS(clamped.setParameter(1, 0.0f),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("Biquad design matches the cookbook responses", "[blocks]") {
+    using blocks::FilterType;
+    const double rate = blocks::kDefaultSampleRate;
+    auto magnitude = [rate](const blocks::BiquadCoefficients& c,
+                            double frequency) {
+        auto z = std::polar(1.0, -2.0 * 3.14159265358979 * frequency / rate);
+        std::complex<double> b0 = c.b0, b1 = c.b1, b2 = c.b2;
+        std::complex<double> a1 = c.a1, a2 = c.a2;
+        return std::abs((b0 + b1 * z + b2 * z * z) /
+                        (1.0 + a1 * z + a2 * z * z));
+    };
+    auto design = [rate](FilterType type, float frequency, float gainDb) {
+        return blocks::BiquadCoefficients::design(
+            {type, frequency, 0.70710678f, gainDb}, rate);
+    };
+    using Catch::Matchers::WithinAbs;
+    auto lowPass = design(FilterType::LowPass, 1000.0f, 0.0f);
+    REQUIRE_THAT(magnitude(lowPass, 0.0), WithinAbs(1.0, 1e-5));
+    REQUIRE_THAT(magnitude(lowPass, 1000.0), WithinAbs(std::sqrt(0.5), 1e-5));
+    REQUIRE(magnitude(lowPass, 20000.0) < 0.01);
+    auto highPass = design(FilterType::HighPass, 1000.0f, 0.0f);
+    REQUIRE(magnitude(highPass, 10.0) < 1e-3);
+    REQUIRE_THAT(magnitude(highPass, rate / 2), WithinAbs(1.0, 1e-5));
+    auto peak = design(FilterType::Peak, 3000.0f, 6.0f);
+    REQUIRE_THAT(magnitude(peak, 3000.0), WithinAbs(std::pow(10, 0.3), 1e-4));
+    REQUIRE_THAT(magnitude(peak, 0.0), WithinAbs(1.0, 1e-5));
+    auto lowShelf = design(FilterType::LowShelf, 200.0f, -12.0f);
+    REQUIRE_THAT(magnitude(lowShelf, 0.0), WithinAbs(std::pow(10, -0.6), 1e-4));
+    REQUIRE_THAT(magnitude(lowShelf, rate / 2), WithinAbs(1.0, 1e-4));
+    auto highShelf = design(FilterType::HighShelf, 5000.0f, 6.0f);
+    REQUIRE_THAT(magnitude(highShelf, 0.0), WithinAbs(1.0, 1e-4));
+    REQUIRE_THAT(magnitude(highShelf, rate / 2),
+                 WithinAbs(std::pow(10, 0.3), 1e-4));
+    REQUIRE(lowPass.getDecayLength() < 1000);
+}
+
+TEST_CASE("Biquad cascades and banks filter like single sections",
+          "[blocks]") {
+    using blocks::FilterType;
+    const std::vector<blocks::FilterBand> bands = {
+        {FilterType::HighPass, 40.0f, 0.7f, 0.0f},
+        {FilterType::LowShelf, 150.0f, 0.7f, 3.0f},
+        {FilterType::Peak, 1000.0f, 2.0f, -4.0f},
+        {FilterType::HighShelf, 8000.0f, 0.7f, 2.0f},
+        {FilterType::LowPass, 16000.0f, 0.7f, 0.0f}};
+    std::vector<float> input(1000);
+    for (uint i = 0; i < input.size(); ++i) {
+        input[i] = std::sin(0.02f * float(i)) + 0.5f * std::sin(1.3f * i);
+    }
+
+    // Section by section, frame by frame
+    std::vector<float> expected = input;
+    for (const auto& band : bands) {
+        blocks::Biquad section({band});
+        for (float& x : expected) {
+            x = section.process(x);
+        }
+    }
+    auto mismatches = [&expected](const std::vector<float>& output) {
+        uint count = 0;
+        for (uint i = 0; i < output.size(); ++i) {
+            count += std::fabs(output[i] - expected[i]) > 1e-5f;
+        }
+        return count;
+    };
+
+    // Pipelined across sections, in place, in uneven buffers
+    blocks::Biquad cascade(bands);
+    std::vector<float> output = input;
+    for (uint done = 0; done < output.size();) {
+        uint n = std::min<uint>(done % 7 + 1, uint(output.size()) - done);
+        cascade.processBuffer(output.data() + done, output.data() + done, n);
+        done += n;
+    }
+    REQUIRE(mismatches(output) == 0);
+    REQUIRE(cascade.getTailLength() > 0);
+
+    // Every channel of a bank, frame by frame and in buffers
+    blocks::BiquadBank bank(3, bands);
+    blocks::BiquadBank perFrame(3, bands);
+    std::vector<std::vector<float>> channels(3, input);
+    channels[1].assign(input.size(), 0.0f);
+    for (uint done = 0; done < input.size(); done += 100) {
+        const float* inputs[] = {channels[0].data() + done,
+                                 channels[1].data() + done,
+                                 channels[2].data() + done};
+        float* outputs[] = {channels[0].data() + done,
+                            channels[1].data() + done,
+                            channels[2].data() + done};
+        bank.evaluateBuffer(inputs, outputs, 100);
+    }
+    std::vector<float> frames(input.size());
+    for (uint i = 0; i < input.size(); ++i) {
+        perFrame.setInput(input[i], 2);
+        perFrame.evaluate();
+        frames[i] = perFrame.getOutput(2);
+    }
+    REQUIRE(mismatches(channels[0]) == 0);
+    REQUIRE(mismatches(channels[2]) == 0);
+    REQUIRE(mismatches(frames) == 0);
+    REQUIRE(std::count(channels[1].cbegin(), channels[1].cend(), 0.0f) ==
+            long(input.size()));
+}
+
+TEST_CASE("Biquad parameter changes glide to the new response",
+          "[blocks]") {
+    using blocks::FilterType;
+    blocks::Biquad swept({{FilterType::Peak, 1000.0f, 1.0f, 0.0f}});
+    blocks::Biquad target({{FilterType::Peak, 1000.0f, 1.0f, 12.0f}});
+    std::vector<float> input(4096);
+    for (uint i = 0; i < input.size(); ++i) {
+        input[i] = std::sin(2.0f * 3.14159265f * 1000.0f * float(i) /
+                            float(blocks::kDefaultSampleRate));
+    }
+    float largestStep = 0.0f;
+    float previous = 0.0f;
+    for (uint i = 0; i < 1024; ++i) {
+        if (i == 512) {
+            swept.setParameter(2, 12.0f);
+        }
+        float y = swept.process(input[i]);
+        largestStep = std::max(largestStep, std::fabs(y - previous));
+        previous = y;
+    }
+    // A unit 1 kHz sine moves at most 0.15 per frame, boosted fourfold 0.6;
+    // a click would jump further
+    REQUIRE(largestStep < 4.0f * 0.15f);
+    for (uint i = 0; i < 1024; ++i) {
+        target.process(input[i]);
+    }
+    uint mismatches = 0;
+    for (uint i = 1024; i < input.size(); ++i) {
+        mismatches += std::fabs(swept.process(input[i]) -
+                                target.process(input[i])) > 1e-3f;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE_THROWS_AS(swept.setParameter(3, 0.0f),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("FFT matches the discrete Fourier transform", "[blocks]") {
+    const size_t size = 64;
+    blocks::Fft fft(size);
+    std::vector<float> signal(size);
+    for (size_t i = 0; i < size; ++i) {
+        signal[i] = std::sin(0.3f * float(i)) + float(i % 5) * 0.1f;
+    }
+    std::vector<std::complex<float>> spectrum(fft.getBinCount());
+    fft.forward(signal.data(), spectrum.data());
+    uint mismatches = 0;
+    for (size_t k = 0; k < fft.getBinCount(); ++k) {
+        std::complex<double> expected = 0.0;
+        for (size_t i = 0; i < size; ++i) {
+            expected += double(signal[i]) *
+                        std::polar(1.0, -2.0 * 3.14159265358979 * double(k) *
+                                            double(i) / double(size));
+        }
+        mismatches +=
+            std::abs(std::complex<double>(spectrum[k]) - expected) > 1e-4;
+    }
+    REQUIRE(mismatches == 0);
+
+    std::vector<float> restored(size);
+    fft.inverse(spectrum.data(), restored.data());
+    for (size_t i = 0; i < size; ++i) {
+        mismatches += std::fabs(restored[i] - signal[i]) > 1e-5f;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE_THROWS_AS(blocks::Fft(48), blocks::invalid_operation_error);
+}
+
+TEST_CASE("Partitioned convolution equals direct convolution",
+          "[blocks]") {
+    // Reaches into the tail partitions; a decaying, pseudo-random response
+    std::vector<float> response(5000);
+    uint32_t state = 12345;
+    auto noise = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return float(state >> 8) / float(1u << 24) - 0.5f;
+    };
+    for (size_t k = 0; k < response.size(); ++k) {
+        response[k] = noise() * std::exp(-float(k) / 1500.0f);
+    }
+    std::vector<float> input(9000);
+    for (float& x : input) {
+        x = noise();
+    }
+    std::vector<double> expected(input.size(), 0.0);
+    for (size_t n = 0; n < input.size(); ++n) {
+        for (size_t k = 0; k < response.size() && k <= n; ++k) {
+            expected[n] += double(response[k]) * input[n - k];
+        }
+    }
+
+    for (bool background : {true, false}) {
+        blocks::Convolution convolution(response, background);
+        REQUIRE(convolution.getTailLength() == 4999);
+        std::vector<float> output = input;
+        for (size_t done = 0; done < output.size();) {
+            size_t n = std::min<size_t>(done % 300 + 1, output.size() - done);
+            convolution.processBuffer(output.data() + done,
+                                      output.data() + done, n);
+            // Faster than real time, so let the tail keep up
+            convolution.waitUntilComputed();
+            done += n;
+        }
+        uint mismatches = 0;
+        for (size_t n = 0; n < output.size(); ++n) {
+            mismatches += std::fabs(output[n] - expected[n]) > 1e-3;
+        }
+        REQUIRE(mismatches == 0);
+        REQUIRE(convolution.getOverrunCount() == 0);
+
+        // Restarts from silence
+        convolution.reset();
+        float impulse = convolution.process(1.0f);
+        REQUIRE(impulse == response[0]);
+        for (size_t k = 1; k < 3000; ++k) {
+            convolution.waitUntilComputed();
+            mismatches +=
+                std::fabs(convolution.process(0.0f) - response[k]) > 1e-4f;
+        }
+        REQUIRE(mismatches == 0);
+    }
+
+    // Short responses run on the head alone
+    blocks::Convolution echo({0.5f, 0.0f, 0.25f});
+    REQUIRE(echo.process(1.0f) == 0.5f);
+    REQUIRE(echo.process(0.0f) == 0.0f);
+    REQUIRE(echo.process(0.0f) == 0.25f);
+    REQUIRE(echo.process(0.0f) == 0.0f);
+    auto copy = echo.clone();
+    REQUIRE(copy->process(2.0f) == 1.0f);
+}
+
+TEST_CASE("Convolution clones carry on mid-stream and never wait for the "
+          "tail",
+          "[blocks]") {
+    std::vector<float> response(6000);
+    for (size_t k = 0; k < response.size(); ++k) {
+        response[k] = std::exp(-float(k) / 2000.0f) * (k % 7 == 0);
+    }
+    std::vector<float> input(5000);
+    for (size_t n = 0; n < input.size(); ++n) {
+        input[n] = float(std::sin(0.05 * double(n)));
+    }
+    blocks::Convolution convolution(response);
+    for (size_t done = 0; done < 2500; done += 100) {
+        convolution.processBuffer(&input[done], &input[done], 100);
+        convolution.waitUntilComputed();
+    }
+    auto copy = convolution.clone();
+    auto& copied = static_cast<blocks::Convolution&>(*copy);
+    std::vector<float> output(input.begin() + 2500, input.end());
+    std::vector<float> copyOutput = output;
+    for (size_t done = 0; done < output.size(); done += 100) {
+        convolution.processBuffer(&output[done], &output[done], 100);
+        convolution.waitUntilComputed();
+        copied.processBuffer(&copyOutput[done], &copyOutput[done], 100);
+        copied.waitUntilComputed();
+    }
+    REQUIRE(output == copyOutput);
+
+    // Without waiting, late tail blocks replay the previous one instead
+    std::vector<float> fast(200000, 1.0f);
+    for (size_t done = 0; done < fast.size(); done += 64) {
+        copied.processBuffer(&fast[done], &fast[done], 64);
+    }
+    REQUIRE(copied.getOverrunCount() <= fast.size() / 1024);
+    uint nonFinite = 0;
+    for (float x : fast) {
+        nonFinite += !std::isfinite(x);
+    }
+    REQUIRE(nonFinite == 0);
+}
+
+namespace {
+
+// Threads in this process, or 0 where the system does not tell
+uint countThreads() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return uint(std::stoul(line.substr(8)));
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+TEST_CASE("Convolutions share one tail worker", "[blocks]") {
+    std::vector<float> response(3000);
+    for (size_t k = 0; k < response.size(); ++k) {
+        response[k] = std::exp(-float(k) / 1000.0f) * (k % 3 == 0);
+    }
+    const uint threads = countThreads();
+    std::vector<std::unique_ptr<blocks::Process>> background, foreground;
+    for (uint i = 0; i < 4; ++i) {
+        background.emplace_back(
+            std::make_unique<blocks::Convolution>(response));
+        background.emplace_back(background.back()->clone());
+        foreground.emplace_back(
+            std::make_unique<blocks::Convolution>(response, false));
+        foreground.emplace_back(foreground.back()->clone());
+    }
+    if (threads > 0) {
+        REQUIRE(countThreads() == threads + 1);
+    }
+    std::vector<float> input(4096);
+    for (size_t n = 0; n < input.size(); ++n) {
+        input[n] = float(std::sin(0.01 * double(n * n % 977)));
+    }
+    for (size_t done = 0; done < input.size(); done += 128) {
+        // Convolutions leave the worker while the others keep it busy
+        if (done == 2048) {
+            background.resize(3);
+            foreground.resize(3);
+        }
+        for (size_t i = 0; i < background.size(); ++i) {
+            std::vector<float> expected(128), output(128);
+            foreground[i]->processBuffer(&input[done], expected.data(), 128);
+            background[i]->processBuffer(&input[done], output.data(), 128);
+            static_cast<blocks::Convolution&>(*background[i])
+                .waitUntilComputed();
+            REQUIRE(output == expected);
+        }
+    }
+}
+
+namespace {
+
+class Cube : public blocks::Process {
+  public:
+    float process(float x) override { return x * x * x; }
+    std::unique_ptr<blocks::Process> clone() const override {
+        return std::make_unique<Cube>(*this);
+    }
+};
+
+// Magnitude of DFT bin k of the signal, normalized to a sine's amplitude
+double binMagnitude(const std::vector<float>& signal, size_t k) {
+    std::complex<double> sum = 0.0;
+    for (size_t i = 0; i < signal.size(); ++i) {
+        sum += double(signal[i]) *
+               std::polar(1.0, -2.0 * 3.14159265358979 * double(k) *
+                                   double(i) / double(signal.size()));
+    }
+    return 2.0 * std::abs(sum) / double(signal.size());
+}
+
+} // namespace
+
+TEST_CASE("Oversampling runs the wrapped block at a higher rate",
+          "[blocks]") {
+    const double rate = blocks::kDefaultSampleRate;
+    const double frequency = 1000.0;
+    auto sine = [&](double frame) {
+        return float(std::sin(2.0 * 3.14159265358979 * frequency * frame /
+                              rate));
+    };
+    for (uint factor : {2u, 4u, 8u}) {
+        // Ten frames of delay at the base rate are 10 * factor inside
+        auto delay = std::make_shared<blocks::ProcessBlock>(
+            std::make_unique<blocks::Delay>(float(10.0 / rate)));
+        blocks::Oversampler oversampler(delay, factor);
+        REQUIRE(oversampler.getFactor() == factor);
+        std::vector<float> signal(2000);
+        for (uint i = 0; i < signal.size(); ++i) {
+            signal[i] = sine(i);
+        }
+        for (uint done = 0; done < signal.size(); done += 500) {
+            const float* inputs[] = {signal.data() + done};
+            float* outputs[] = {signal.data() + done};
+            oversampler.evaluateBuffer(inputs, outputs, 500);
+        }
+        const double lag = 10.0 + oversampler.getLatency();
+        uint mismatches = 0;
+        for (uint i = 100; i < signal.size(); ++i) {
+            mismatches += std::fabs(signal[i] - sine(i - lag)) > 1e-3f;
+        }
+        REQUIRE(mismatches == 0);
+    }
+
+    // Parameters reach the wrapped block
+    auto gain = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0f));
+    blocks::Oversampler boosted(gain, 2);
+    boosted.setParameter(0, 2.0f);
+    float last = 0.0f;
+    for (uint i = 0; i < 200; ++i) {
+        boosted.setInput(0.5f);
+        boosted.evaluate();
+        last = boosted.getOutput();
+    }
+    REQUIRE_THAT(last, Catch::Matchers::WithinAbs(1.0f, 1e-4f));
+    REQUIRE_THROWS_AS(blocks::Oversampler(gain, 3),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("Oversampler clones process into their own buffers",
+          "[blocks]") {
+    auto makeOversampler = [] {
+        return std::make_shared<blocks::Oversampler>(
+            std::make_shared<blocks::ProcessBlock>(
+                std::make_unique<blocks::Gain>(2.0f)),
+            4);
+    };
+    std::vector<float> input(512);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = float(std::sin(0.05 * double(i)));
+    }
+    auto run = [&](blocks::Block& block, size_t offset) {
+        std::vector<float> output(256);
+        const float* inputs[] = {input.data() + offset};
+        float* outputs[] = {output.data()};
+        block.evaluateBuffer(inputs, outputs, 256);
+        return output;
+    };
+    auto original = makeOversampler();
+    auto reference = makeOversampler();
+    run(*original, 0);
+    run(*reference, 0);
+    // The clone carries on from the original's state, alone
+    auto copy = original->clone();
+    original.reset();
+    REQUIRE(run(*copy, 256) == run(*reference, 256));
+}
+
+TEST_CASE("Oversampling suppresses aliasing of a nonlinearity",
+          "[blocks]") {
+    // A sine on bin 929 of 4096 cubed has a third harmonic past Nyquist,
+    // which aliases to bin 4096 - 3 * 929 = 1309
+    const size_t size = 4096;
+    std::vector<float> input(size + 512);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = float(
+            std::sin(2.0 * 3.14159265358979 * 929.0 * double(i) / size));
+    }
+    auto run = [&](blocks::Block& block) {
+        std::vector<float> output(input.size());
+        const float* inputs[] = {input.data()};
+        float* outputs[] = {output.data()};
+        block.evaluateBuffer(inputs, outputs, uint(input.size()));
+        // Past the filters' settling
+        return std::vector<float>(output.end() - size, output.end());
+    };
+    blocks::ProcessBlock plain(std::make_unique<Cube>());
+    blocks::Oversampler oversampled(
+        std::make_shared<blocks::ProcessBlock>(std::make_unique<Cube>()), 4);
+    auto aliased = run(plain);
+    auto clean = run(oversampled);
+    REQUIRE_THAT(binMagnitude(aliased, 1309),
+                 Catch::Matchers::WithinAbs(0.25, 1e-3));
+    REQUIRE(binMagnitude(clean, 1309) < 1e-3);
+    REQUIRE_THAT(binMagnitude(clean, 929),
+                 Catch::Matchers::WithinAbs(0.75, 1e-2));
+}
+
+TEST_CASE("Waveshaper follows its transfer function", "[blocks]") {
+    auto cubic = [](float x) {
+        float t = x < 0.0f ? x + 1.0f : x - 1.0f;
+        return t * t * t + (x < 0.0f ? -1.0f : 1.0f);
+    };
+    auto chain = [&](float x) { return cubic(cubic(cubic(cubic(x)))); };
+    auto soft = [](float x) { return x - x * x * x / 3.0f; };
+    auto tanh = [](float x) { return std::tanh(x); };
+    // The chain is steep around 0, so it takes finer segments
+    blocks::Waveshaper table(chain, 1.0f, blocks::ShaperMode::Table, 2048);
+    blocks::Waveshaper polynomial(soft, 1.0f, blocks::ShaperMode::Polynomial,
+                                  3);
+    blocks::Waveshaper smooth(tanh, 1.0f, blocks::ShaperMode::Polynomial);
+    std::vector<float> input(1000);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = -1.0f + 2.0f * float(i) / float(input.size() - 1);
+    }
+    std::vector<float> tableOutput(input.size());
+    std::vector<float> polynomialOutput(input.size());
+    table.processBuffer(input.data(), tableOutput.data(), input.size());
+    polynomial.processBuffer(input.data(), polynomialOutput.data(),
+                             input.size());
+    uint mismatches = 0;
+    for (size_t i = 0; i < input.size(); ++i) {
+        float x = input[i];
+        mismatches += std::abs(tableOutput[i] - chain(x)) > 1e-3f;
+        mismatches += std::abs(polynomialOutput[i] - soft(x)) > 1e-5f;
+        mismatches += std::abs(smooth.process(x) - std::tanh(x)) > 1e-5f;
+        mismatches += table.process(x) != tableOutput[i];
+    }
+    REQUIRE(mismatches == 0);
+    // Inputs beyond the range are clamped to it
+    REQUIRE_THAT(table.process(3.0f),
+                 Catch::Matchers::WithinAbs(chain(1.0f), 1e-6));
+    REQUIRE_THAT(polynomial.process(-3.0f),
+                 Catch::Matchers::WithinAbs(soft(-1.0f), 1e-5));
+    // NaN stays within the table, at its low end
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    REQUIRE(table.process(nan) == table.process(-1.0f));
+    REQUIRE(polynomial.process(nan) == polynomial.process(-1.0f));
+}
+
+TEST_CASE("FDN reverb matches a per-sample feedback delay network",
+          "[blocks]") {
+    const size_t lengths[] = {37, 53, 61, 79};
+    std::vector<float> times;
+    for (size_t length : lengths) {
+        times.push_back(float(length / blocks::kDefaultSampleRate));
+    }
+    const float decay = 0.05f;
+    blocks::FdnReverb reverb(decay, times);
+    std::vector<float> input(2000, 0.0f);
+    for (size_t i = 0; i < 300; ++i) {
+        input[i] = float(std::sin(0.1 * double(i)));
+    }
+    // Direct form, with the Hadamard matrix written out
+    std::vector<std::vector<float>> lines(4,
+                                          std::vector<float>(input.size()));
+    std::vector<float> expected(input.size());
+    for (size_t n = 0; n < input.size(); ++n) {
+        float y[4];
+        for (size_t i = 0; i < 4; ++i) {
+            y[i] = n >= lengths[i] ? lines[i][n - lengths[i]] : 0.0f;
+        }
+        expected[n] = 0.5f * (y[0] + y[1] + y[2] + y[3]);
+        for (size_t i = 0; i < 4; ++i) {
+            float sum = 0.0f;
+            for (size_t k = 0; k < 4; ++k) {
+                float gain = float(std::pow(
+                    10.0, -3.0 * double(lengths[k]) /
+                              (decay * blocks::kDefaultSampleRate)));
+                float sign = __builtin_popcount(unsigned(i & k)) % 2 ? -1 : 1;
+                sum += sign * gain * y[k];
+            }
+            lines[i][n] = 0.5f * sum + input[n];
+        }
+    }
+    // Steps both shorter and longer than the shortest line
+    std::vector<float> output(input.size());
+    const size_t steps[] = {1, 36, 100, 7, 37};
+    for (size_t done = 0, s = 0; done < input.size(); ++s) {
+        size_t n = std::min(steps[s % 5], input.size() - done);
+        reverb.processBuffer(input.data() + done, output.data() + done, n);
+        done += n;
+    }
+    uint mismatches = 0;
+    for (size_t n = 0; n < input.size(); ++n) {
+        mismatches += std::abs(output[n] - expected[n]) > 1e-5f;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE_THROWS_AS(blocks::FdnReverb(1.0f, {0.01f, 0.02f, 0.03f}),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("FDN reverb decays by 60 dB over its decay time", "[blocks]") {
+    const double rate = blocks::kDefaultSampleRate;
+    auto drop = [&](float damping) {
+        blocks::FdnReverb reverb(0.5f, {}, damping);
+        std::vector<float> signal(size_t(rate), 0.0f);
+        signal[0] = 1.0f;
+        reverb.processBuffer(signal.data(), signal.data(), signal.size());
+        auto energy = [&](double start) {
+            double sum = 0.0;
+            for (size_t i = size_t(start * rate);
+                 i < size_t((start + 0.1) * rate); ++i) {
+                sum += double(signal[i]) * signal[i];
+            }
+            return sum;
+        };
+        return 10.0 * std::log10(energy(0.2) / energy(0.7));
+    };
+    double plain = drop(0.0f);
+    REQUIRE_THAT(plain, Catch::Matchers::WithinAbs(60.0, 3.0));
+    // High frequencies die away faster
+    REQUIRE(drop(0.5f) > plain + 1.0);
+    blocks::FdnReverb reverb(0.5f);
+    REQUIRE(reverb.getTailLength() >= size_t(rate));
+    reverb.setParameter(0, 1.0f);
+    REQUIRE(reverb.getTailLength() >= size_t(2.0 * rate));
+    REQUIRE_THROWS_AS(reverb.setParameter(2, 0.0f),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("Compressor settles on its static curve", "[blocks]") {
+    blocks::DynamicsSettings settings;
+    settings.thresholdDb = -20.0f;
+    settings.ratio = 4.0f;
+    settings.kneeDb = 0.0f;
+    settings.attack = 0.001f;
+    settings.release = 0.01f;
+    blocks::Dynamics compressor(1, settings, 1);
+    auto settle = [&](float level) {
+        std::vector<float> signal(4410, level);
+        const float* inputs[] = {signal.data()};
+        float* outputs[] = {signal.data()};
+        compressor.evaluateBuffer(inputs, outputs, uint(signal.size()));
+        return signal.back();
+    };
+    // 0.5 is 13.98 dB over, reduced to a quarter of that
+    const float reduced = float(0.5 * std::pow(10.0, -0.75 * 13.9794 / 20.0));
+    REQUIRE_THAT(settle(0.5f), Catch::Matchers::WithinRel(reduced, 1e-3f));
+    REQUIRE_THAT(settle(0.01f), Catch::Matchers::WithinRel(0.01f, 1e-4f));
+    compressor.setParameter(5, 0.75f * 13.9794f);
+    REQUIRE_THAT(settle(0.5f), Catch::Matchers::WithinRel(0.5f, 1e-3f));
+    REQUIRE_THROWS_AS(compressor.setParameter(6, 0.0f),
+                      blocks::invalid_operation_error);
+    REQUIRE_THROWS_AS(blocks::Dynamics(3, settings, 2),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("Lookahead limiter holds its ceiling on linked channels",
+          "[blocks]") {
+    blocks::DynamicsSettings settings;
+    settings.thresholdDb = -1.0f;
+    settings.ratio = std::numeric_limits<float>::infinity();
+    settings.kneeDb = 0.0f;
+    settings.attack = 0.0f;
+    settings.release = 0.05f;
+    settings.lookahead = 0.005f;
+    blocks::Dynamics limiter(2, settings);
+    const uint latency = 220;
+    REQUIRE(limiter.getLatency() == float(latency));
+    std::vector<float> loud(20000);
+    std::vector<float> quiet(loud.size());
+    for (size_t n = 0; n < loud.size(); ++n) {
+        bool burst = n >= 5000 && n < 6000;
+        loud[n] = float((burst ? 4.0 : 0.3) * std::sin(0.3 * double(n)));
+        quiet[n] = float(0.1 * std::sin(0.07 * double(n)));
+    }
+    std::vector<float> loudOut(loud.size());
+    std::vector<float> quietOut(loud.size());
+    auto single = limiter.clone();
+    for (size_t done = 0; done < loud.size(); done += 100) {
+        const float* inputs[] = {loud.data() + done, quiet.data() + done};
+        float* outputs[] = {loudOut.data() + done, quietOut.data() + done};
+        limiter.evaluateBuffer(inputs, outputs, 100);
+    }
+    const float ceiling = float(std::pow(10.0, -1.0 / 20.0));
+    uint mismatches = 0;
+    for (size_t n = latency; n < loud.size(); ++n) {
+        float in = loud[n - latency];
+        mismatches += std::abs(loudOut[n]) > ceiling * 1.001f;
+        // Both channels get the same gain
+        mismatches += std::abs(quietOut[n] * in -
+                               loudOut[n] * quiet[n - latency]) > 1e-5f;
+        // Untouched before the burst
+        if (n < 5000) {
+            mismatches += std::abs(loudOut[n] - in) > 1e-5f;
+        }
+    }
+    for (size_t n = 0; n < 3000; ++n) {
+        single->setInput(loud[n], 0);
+        single->setInput(quiet[n], 1);
+        single->evaluate();
+        mismatches += single->getOutput(0) != loudOut[n];
+    }
+    REQUIRE(mismatches == 0);
+    // The burst is limited rather than muted
+    REQUIRE(*std::max_element(loudOut.begin() + 5000, loudOut.end()) >
+            ceiling * 0.95f);
+    // Inside an oversampler the lookahead counts at the base rate
+    blocks::Oversampler oversampled(
+        std::make_shared<blocks::Dynamics>(1, settings, 1), 2);
+    REQUIRE_THAT(oversampled.getLatency(),
+                 Catch::Matchers::WithinAbs(23.0 + 441.0 / 2.0, 1e-4));
+}
+
+TEST_CASE("Wavetable oscillators play band-limited cycles", "[blocks]") {
+    const double rate = blocks::kDefaultSampleRate;
+    const double twoPi = 2.0 * 3.14159265358979;
+    auto play = [](blocks::Block& source, size_t nFrames) {
+        std::vector<float> output(nFrames);
+        float* outputs[] = {output.data()};
+        source.evaluateBuffer(nullptr, outputs, uint(nFrames));
+        return output;
+    };
+    blocks::Oscillator sine(blocks::Wavetable::get(blocks::Waveform::Sine),
+                            1000.0f, 0.5f, 0.25f);
+    auto single = sine.clone();
+    auto sines = play(sine, 5000);
+    uint mismatches = 0;
+    for (size_t n = 0; n < sines.size(); ++n) {
+        float expected =
+            float(0.25 + 0.5 * std::sin(twoPi * 1000.0 * double(n) / rate));
+        mismatches += std::abs(sines[n] - expected) > 1e-4f;
+        single->evaluate();
+        mismatches += single->getOutput() != sines[n];
+    }
+    // A saw on bin 300 of 4096 keeps the harmonics below Nyquist that its
+    // table level holds, and nothing else
+    const size_t size = 4096;
+    blocks::Oscillator saw(blocks::Wavetable::get(blocks::Waveform::Saw),
+                           float(300.0 * rate / size));
+    auto saws = play(saw, size);
+    for (size_t k = 1; k < size / 2; ++k) {
+        double expected = 0.0;
+        if (k % 300 == 0 && k / 300 <= 4) {
+            expected = 2.0 / (3.14159265358979 * double(k / 300));
+        }
+        mismatches += std::abs(binMagnitude(saws, k) - expected) > 1e-3;
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(blocks::Wavetable::get(blocks::Waveform::Saw) ==
+            blocks::Wavetable::get(blocks::Waveform::Saw));
+    // Any cycle: three periods of a sine play as its third harmonic
+    std::vector<float> cycle(64);
+    for (size_t i = 0; i < cycle.size(); ++i) {
+        cycle[i] = float(std::sin(twoPi * 3.0 * double(i) / 64.0));
+    }
+    blocks::Oscillator custom(std::make_shared<blocks::Wavetable>(cycle),
+                              100.0f);
+    auto customs = play(custom, 1000);
+    float error = 0.0f;
+    for (size_t n = 0; n < customs.size(); ++n) {
+        error = std::max(error, std::abs(customs[n] - float(std::sin(
+                                              twoPi * 300.0 * n / rate))));
+    }
+    REQUIRE(error < 1e-4f);
+    REQUIRE_THROWS_AS(blocks::Wavetable(std::vector<float>(48)),
+                      blocks::invalid_operation_error);
+    REQUIRE_THROWS_AS(custom.setParameter(4, 0.0f),
+                      blocks::invalid_operation_error);
+}
+
+TEST_CASE("An LFO at control rate keeps its frequency", "[blocks]") {
+    const double rate = blocks::kDefaultSampleRate;
+    auto blockSystem = std::make_shared<blocks::BlockSystem>();
+    auto lfo = std::make_shared<blocks::Oscillator>(
+        blocks::Wavetable::get(blocks::Waveform::Sine), 5.0f);
+    auto audio = std::make_shared<blocks::ProcessBlock>(
+        std::make_unique<blocks::Gain>(1.0));
+    blockSystem->addBlock(lfo);
+    blockSystem->addBlock(audio);
+    blocks::Connection connection;
+    connection.source.block = lfo;
+    connection.target.block = audio;
+    blockSystem->addConnection(connection);
+    blocks::Port port;
+    port.block = audio;
+    blockSystem->addOutput(port);
+    blockSystem->setRateDivisor(lfo, 64);
+    std::vector<float> output(20000);
+    for (size_t done = 0; done < output.size(); done += 500) {
+        float* outputs[] = {output.data() + done};
+        blockSystem->evaluateBuffer(nullptr, outputs, 500);
+    }
+    // Ramped towards each control value over the following 64 frames
+    uint mismatches = 0;
+    for (size_t n = 63; n < output.size(); ++n) {
+        double phase = 2.0 * 3.14159265358979 * 5.0 * double(n - 63) / rate;
+        mismatches += std::abs(output[n] - float(std::sin(phase))) > 1e-3f;
+    }
+    REQUIRE(mismatches == 0);
+}